@@ -0,0 +1,45 @@
+#pragma once
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// Heap allocation counter, used to check that training does not allocate.
+// It replaces the global operator new, so include it from one translation
+// unit of a program only, as every trainer is. Worker and cluster threads
+// allocate concurrently, so the count is atomic. Node tables taken with
+// std::aligned_alloc bypass operator new and are not counted, but
+// over-aligned objects created with new are.
+static std::atomic<long> g_allocations {0};
+
+void *operator new(std::size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    // aligned_alloc wants a multiple of the alignment
+    std::size_t align = static_cast<std::size_t>(alignment);
+    if (void *p = std::aligned_alloc(align, (size + align - 1) / align * align))
+        return p;
+    throw std::bad_alloc();
+}
+
+// not inlined, or GCC 12 mistakes the free() for a mismatched deallocation
+__attribute__((noinline)) void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete(void *p, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete(void *p, std::size_t, std::align_val_t) noexcept {
+    std::free(p);
+}
@@ -0,0 +1,153 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include "Options.h"
+
+// Regression benchmark of every trainer. Each game and training mode runs
+// in its own process, the trainer binary started with --bench (see
+// Benchmark.h), so that peak RSS is that of the one game. For each it
+// reports as CSV, or JSON with --json: iterations and nodes touched per
+// second over a fixed iteration budget, peak RSS, the exploitability
+// reached after training a fresh trainer for --seconds, the regret storage
+// the trainer was built with (see NodeStorage.h), its bytes per node, and
+// the cache miss rate of the timed iterations where the kernel counts them.
+//
+// Trainer binaries are looked for next to this one, or in --bin-dir.
+// --scale multiplies every iteration budget and --only runs the games
+// whose name contains its value.
+
+struct Run {
+    const char *game, *mode, *program;
+    std::vector<std::string> args;
+    long iterations;
+    const char *unit;
+};
+
+struct Result {
+    long iterations = 0, nodes = 0, peakRssKiB = 0, nodeBytes = 0;
+    double seconds = 0.0, budgetSeconds = 0.0, exploitability = 0.0, cacheMissRate = -1.0;
+    std::string storage;
+};
+
+// Runs a trainer with --bench and collects its report line and peak RSS
+Result runTrainer(const std::string &path, std::vector<std::string> args) {
+    int fds[2];
+    if (pipe(fds) != 0)
+        throw std::runtime_error("cannot create pipe");
+    pid_t pid = fork();
+    if (pid < 0)
+        throw std::runtime_error("cannot fork");
+    if (pid == 0) {
+        dup2(fds[1], STDOUT_FILENO);
+        close(fds[0]);
+        close(fds[1]);
+        std::vector<char *> argv {const_cast<char *>(path.c_str())};
+        for (std::string &arg : args)
+            argv.push_back(&arg[0]);
+        argv.push_back(nullptr);
+        execv(path.c_str(), argv.data());
+        _exit(127);
+    }
+    close(fds[1]);
+    std::string output;
+    char buffer[4096];
+    for (ssize_t n; (n = read(fds[0], buffer, sizeof(buffer))) > 0; )
+        output.append(buffer, n);
+    close(fds[0]);
+
+    int status;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        throw std::runtime_error(path + " failed");
+
+    Result result;
+    std::istringstream lines(output);
+    for (std::string line; std::getline(lines, line); ) {
+        if (line.rfind("bench,", 0) != 0)
+            continue;
+        std::istringstream fields(line.substr(6));
+        char comma;
+        fields >> result.iterations >> comma >> result.seconds >> comma >> result.nodes >> comma
+               >> result.budgetSeconds >> comma >> result.exploitability >> comma;
+        std::getline(fields, result.storage, ',');
+        fields >> result.nodeBytes >> comma >> result.cacheMissRate;
+        result.peakRssKiB = usage.ru_maxrss;
+        return result;
+    }
+    throw std::runtime_error(path + " printed no benchmark line");
+}
+
+int main(int argc, char **argv) {
+    Options options(argc, argv);
+    try {
+        std::string self = argv[0];
+        std::string binDir = options.getString("bin-dir", self.find('/') == std::string::npos
+                                                          ? "." : self.substr(0, self.rfind('/')));
+        double scale = options.getDouble("scale", 1.0);
+        std::string seconds = options.getString("seconds", "1");
+        std::string only = options.getString("only", "");
+        bool json = options.has("json");
+
+        std::vector<Run> runs {
+            {"rps", "sampled", "RockPaperScissors", {}, 10000000, "per game"},
+            {"rps", "full-width", "RockPaperScissors", {"--full-width"}, 10000000, "per game"},
+            {"blotto", "sampled", "ColonelBlotto", {}, 2000000, "per game"},
+            {"blotto", "full-width", "ColonelBlotto", {"--full-width"}, 1000000, "per game"},
+            {"kuhn", "sampled", "KuhnPoker", {}, 5000000, "mbb/g"},
+            {"kuhn", "vector", "KuhnPoker", {"--vector"}, 500000, "mbb/g"},
+            {"kuhn", "batched", "KuhnPoker", {"--batch", "32"}, 10000000, "mbb/g"},
+            {"kuhn", "linear", "KuhnPoker", {"--policy", "linear"}, 5000000, "mbb/g"},
+            {"kuhn-two-cards", "sampled", "KuhnPokerTwoCards", {}, 2000000, "mbb/g"},
+            {"kuhn-two-cards", "vector", "KuhnPokerTwoCards", {"--vector"}, 100000, "mbb/g"},
+            {"kuhn-community-flop", "sampled", "KuhnPokerCommunityFlop", {}, 2000000, "mbb/g"},
+            {"kuhn-community-flop", "vector", "KuhnPokerCommunityFlop", {"--vector"}, 100000, "mbb/g"},
+        };
+
+        if (json)
+            std::cout << "[\n";
+        else
+            std::cout << "game,mode,iterations,seconds,iterations_per_second,nodes_per_second,peak_rss_kib,"
+                         "budget_seconds,exploitability,unit,regret_storage,node_bytes,cache_miss_rate\n";
+        bool first = true;
+        for (Run &run : runs) {
+            std::string name = std::string(run.game) + " " + run.mode;
+            if (name.find(only) == std::string::npos)
+                continue;
+            std::vector<std::string> args {"--bench", "--iterations", std::to_string((long)(run.iterations * scale)),
+                                           "--seconds", seconds};
+            args.insert(args.end(), run.args.begin(), run.args.end());
+            Result r = runTrainer(binDir + "/" + run.program, args);
+            // unknown cache miss rates are left empty, or null in JSON
+            std::string missRate = r.cacheMissRate < 0 ? "" : std::to_string(r.cacheMissRate);
+            if (json) {
+                std::cout << (first ? "" : ",\n") << "  {\"game\": \"" << run.game << "\", \"mode\": \"" << run.mode
+                          << "\", \"iterations\": " << r.iterations << ", \"seconds\": " << r.seconds
+                          << ", \"iterations_per_second\": " << r.iterations / r.seconds
+                          << ", \"nodes_per_second\": " << r.nodes / r.seconds
+                          << ", \"peak_rss_kib\": " << r.peakRssKiB << ", \"budget_seconds\": " << r.budgetSeconds
+                          << ", \"exploitability\": " << r.exploitability << ", \"unit\": \"" << run.unit
+                          << "\", \"regret_storage\": \"" << r.storage << "\", \"node_bytes\": " << r.nodeBytes
+                          << ", \"cache_miss_rate\": " << (missRate.empty() ? "null" : missRate) << "}";
+            } else {
+                std::cout << run.game << "," << run.mode << "," << r.iterations << "," << r.seconds << ","
+                          << r.iterations / r.seconds << "," << r.nodes / r.seconds << "," << r.peakRssKiB << ","
+                          << r.budgetSeconds << "," << r.exploitability << "," << run.unit << "," << r.storage << ","
+                          << r.nodeBytes << "," << missRate << "\n";
+            }
+            std::cout.flush();
+            first = false;
+        }
+        if (json)
+            std::cout << "\n]\n";
+    } catch (const std::exception &e) {
+        std::cerr << "error: " << e.what() << "\n";
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include <chrono>
+#include <cstring>
+#include <cstdint>
+#include <iostream>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "NodeStorage.h"
+
+// The trainers' side of the Benchmark harness. Run with --bench, a trainer
+// calls reportBenchmark() and prints one line for the harness:
+//
+//     bench,<iterations>,<seconds>,<nodes touched>,<budget seconds>,<exploitability>,
+//         <regret storage>,<node bytes>,<cache miss rate>
+//
+// A node is one player's regret table at one decision point; nodes touched
+// counts the nodes whose regrets an iteration updates.
+
+// Counts the last-level cache references and misses of this thread between
+// start() and stop() through perf_event_open. Where the kernel offers no
+// hardware counters (e.g. in many virtual machines) missRate() is -1.
+class CacheCounters {
+public:
+    CacheCounters() {
+        m_references = open(PERF_COUNT_HW_CACHE_REFERENCES);
+        m_misses = open(PERF_COUNT_HW_CACHE_MISSES);
+    }
+
+    ~CacheCounters() {
+        if (m_references >= 0)
+            close(m_references);
+        if (m_misses >= 0)
+            close(m_misses);
+    }
+
+    CacheCounters(const CacheCounters &) = delete;
+    CacheCounters &operator=(const CacheCounters &) = delete;
+
+    void start() {
+        for (int fd : {m_references, m_misses}) {
+            if (fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+    }
+
+    void stop() {
+        for (int fd : {m_references, m_misses})
+            if (fd >= 0)
+                ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    }
+
+    double missRate() const {
+        uint64_t references = 0, misses = 0;
+        if (m_references < 0 || m_misses < 0
+            || read(m_references, &references, sizeof(references)) != sizeof(references)
+            || read(m_misses, &misses, sizeof(misses)) != sizeof(misses) || references == 0)
+            return -1.0;
+        return (double)misses / references;
+    }
+
+private:
+    int m_references, m_misses;
+
+    static int open(uint64_t config) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+};
+
+// Times `iterations` iterations of `trainer`, then trains `timed`, a fresh
+// trainer set up the same way, for `seconds` in batches of a quarter of the
+// iterations so far and evaluates its exploitability, multiplied by `scale`
+// to the trainer's usual unit. nodeBytes is the size of one node of the
+// trainer's table, 0 for trainers without one. Trainers need iterate(n)
+// and exploitability().
+template <typename Trainer>
+void reportBenchmark(Trainer &trainer, Trainer &timed, long iterations, double seconds, long nodesPerIteration,
+                     long nodeBytes, double scale) {
+    using Clock = std::chrono::steady_clock;
+    CacheCounters cache;
+    cache.start();
+    auto start = Clock::now();
+    trainer.iterate(iterations);
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    cache.stop();
+
+    long done = 0;
+    start = Clock::now();
+    while (std::chrono::duration<double>(Clock::now() - start).count() < seconds) {
+        long batch = std::max(1L, done / 4);
+        timed.iterate(batch);
+        done += batch;
+    }
+    std::cout << "bench," << iterations << "," << elapsed << "," << iterations * nodesPerIteration << ","
+              << seconds << "," << scale * timed.exploitability() << "," << REGRET_STORAGE << "," << nodeBytes << ","
+              << cache.missRate() << "\n";
+}
@@ -0,0 +1,175 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <array>
+#include <string>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Binary checkpoints of a trainer's regret and strategy-sum tables.
+//
+// A checkpoint is a 64-byte header followed by two packed arrays of
+// doubles, all regret sums and then all strategy sums, each laid out
+// node-major (node*numActions + action). Values are stored in the host's
+// byte order. The arrays start 64 bytes in, so once the file is mapped they
+// can be read in place: opening a checkpoint costs a page fault per page
+// touched rather than a parse or an allocation per node.
+
+enum class GameId : uint32_t {
+    RockPaperScissors = 1,
+    ColonelBlotto = 2,
+    KuhnPoker = 3,
+    KuhnPokerTwoCards = 4,
+    MatrixGame = 5,
+    KuhnPokerCommunityFlop = 6,
+    KuhnPokerTwoCardsVariant = 7,
+};
+
+// The rules of a game set at run time, in a form that game defines, so
+// that a checkpoint cannot be read as a solution of other rules; all zero
+// for games fixed at compile time
+typedef std::array<uint16_t, 12> CheckpointParameters;
+
+struct CheckpointHeader {
+    static constexpr char MAGIC[8] = {'C', 'F', 'R', 'C', 'K', 'P', 'T', '\0'};
+    static const uint32_t VERSION = 1;
+
+    char magic[8];
+    uint32_t version;
+    GameId game;
+    uint64_t iterations;
+    uint64_t numNodes;
+    uint32_t numActions;
+    uint32_t policy; // ID of the regret-update policy, 0 for vanilla CFR
+    CheckpointParameters parameters;
+};
+static_assert(sizeof(CheckpointHeader) == 64, "checkpoint arrays must start 64 bytes in");
+
+// Writes a checkpoint to `path`. The file is written next to its final
+// location and renamed over it, so an interrupted write never replaces a
+// good checkpoint with a partial one.
+inline void writeCheckpoint(const std::string &path, GameId game, uint64_t iterations, uint64_t numNodes,
+                            uint32_t numActions, const double *regretSums, const double *strategySums,
+                            uint32_t policy = 0, const CheckpointParameters &parameters = {}) {
+    CheckpointHeader header {};
+    std::memcpy(header.magic, CheckpointHeader::MAGIC, sizeof(header.magic));
+    header.version = CheckpointHeader::VERSION;
+    header.game = game;
+    header.iterations = iterations;
+    header.numNodes = numNodes;
+    header.numActions = numActions;
+    header.policy = policy;
+    header.parameters = parameters;
+
+    std::string tmpPath = path + ".tmp";
+    FILE *file = std::fopen(tmpPath.c_str(), "wb");
+    if (!file)
+        throw std::runtime_error("cannot write checkpoint " + tmpPath);
+    size_t count = numNodes * numActions;
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1
+           && std::fwrite(regretSums, sizeof(double), count, file) == count
+           && std::fwrite(strategySums, sizeof(double), count, file) == count;
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok || std::rename(tmpPath.c_str(), path.c_str()) != 0)
+        throw std::runtime_error("failed writing checkpoint " + path);
+}
+
+// Reads and validates the header of the checkpoint at `path`, e.g. to find
+// the rules of a runtime game before mapping it
+inline CheckpointHeader readCheckpointHeader(const std::string &path) {
+    CheckpointHeader header;
+    FILE *file = std::fopen(path.c_str(), "rb");
+    if (!file)
+        throw std::runtime_error("cannot open checkpoint " + path);
+    bool ok = std::fread(&header, sizeof(header), 1, file) == 1;
+    std::fclose(file);
+    if (!ok || std::memcmp(header.magic, CheckpointHeader::MAGIC, sizeof(header.magic)) != 0)
+        throw std::runtime_error("not a checkpoint: " + path);
+    if (header.version != CheckpointHeader::VERSION)
+        throw std::runtime_error("unsupported checkpoint version " + std::to_string(header.version) + ": " + path);
+    return header;
+}
+
+// A read-only, memory-mapped view of a checkpoint. Opening it validates the
+// header against the expected game and table shape.
+class MappedCheckpoint {
+public:
+    MappedCheckpoint(const std::string &path, GameId game, uint64_t numNodes, uint32_t numActions) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("cannot open checkpoint " + path);
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(CheckpointHeader)) {
+            ::close(fd);
+            throw std::runtime_error("truncated checkpoint " + path);
+        }
+        m_size = st.st_size;
+        m_data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (m_data == MAP_FAILED)
+            throw std::runtime_error("cannot map checkpoint " + path);
+
+        const CheckpointHeader &h = header();
+        std::string problem;
+        if (std::memcmp(h.magic, CheckpointHeader::MAGIC, sizeof(h.magic)) != 0)
+            problem = "not a checkpoint";
+        else if (h.version != CheckpointHeader::VERSION)
+            problem = "unsupported checkpoint version " + std::to_string(h.version);
+        else if (h.game != game)
+            problem = "checkpoint is for another game";
+        else if (h.numNodes != numNodes || h.numActions != numActions)
+            problem = "checkpoint table shape does not match";
+        else if (m_size < sizeof(CheckpointHeader) + 2*numNodes*numActions*sizeof(double))
+            problem = "truncated checkpoint";
+        if (!problem.empty()) {
+            munmap(m_data, m_size);
+            throw std::runtime_error(problem + ": " + path);
+        }
+    }
+
+    ~MappedCheckpoint() {
+        munmap(m_data, m_size);
+    }
+
+    MappedCheckpoint(const MappedCheckpoint &) = delete;
+    MappedCheckpoint &operator=(const MappedCheckpoint &) = delete;
+
+    const CheckpointHeader &header() const {
+        return *static_cast<const CheckpointHeader *>(m_data);
+    }
+
+    uint64_t iterations() const {
+        return header().iterations;
+    }
+
+    uint32_t policy() const {
+        return header().policy;
+    }
+
+    const double *regretSums() const {
+        return reinterpret_cast<const double *>(static_cast<const char *>(m_data) + sizeof(CheckpointHeader));
+    }
+
+    const double *strategySums() const {
+        return regretSums() + header().numNodes * header().numActions;
+    }
+
+    // average strategy of a node straight from the mapped strategy sums
+    void averageStrategy(uint64_t node, double *strategy) const {
+        uint32_t numActions = header().numActions;
+        const double *sums = strategySums() + node * numActions;
+        double normalisingSum = 0.0;
+        for (uint32_t a=0; a<numActions; a++)
+            normalisingSum += sums[a];
+        for (uint32_t a=0; a<numActions; a++)
+            strategy[a] = normalisingSum > 0 ? sums[a] / normalisingSum : 1.0 / numActions;
+    }
+
+private:
+    void *m_data;
+    size_t m_size;
+};
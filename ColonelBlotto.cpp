@@ -1,130 +1,169 @@
 #include <iostream>
-#include <random>
-#include <array>
-#include <set>
-#include <map>
-
-typedef std::array<int, 3> Action;
-typedef std::map<Action, double> ActionDoubles;
-
-class BlottoTrainer {
+#include <vector>
+#include <sstream>
+#include "Options.h"
+#include "NormalFormGame.h"
+#include "Benchmark.h"
+
+// Colonel Blotto: each player splits S soldiers over N battlefields, wins a
+// battlefield by sending more soldiers to it, and wins the game by winning
+// more battlefields.
+//
+// The actions are enumerated once, in lexicographic order, into a flat table
+// from which the normal-form engine's payoff matrix is built.
+class BlottoTrainer : public NormalFormCFR<int8_t> {
 public:
-    static const int S = 5;
-    static const int N = 3;
-    static int N_ACTIONS;
-    std::set<Action> allActions; 
-
-    ActionDoubles m_regretSum;
-    ActionDoubles m_strategySum;
-    ActionDoubles m_oppRegretSum;
-    ActionDoubles m_oppStrategySum;
-
-    BlottoTrainer() {
-        // init actions
-        Action a;
-        int nAtThird;
-        for (int nAtFirst = 0; nAtFirst <= S; nAtFirst++) {
-            for (int nAtSecond = 0; nAtSecond+nAtFirst <= S; nAtSecond++) {
-                nAtThird = S - nAtFirst - nAtSecond;
-                a = {nAtFirst, nAtSecond, nAtThird};
-                allActions.insert(a);
-            }
-        }
-    }
+    // games whose utility matrix and its transposed copy would take more
+    // than this are refused unless a larger cap is given
+    static const long DEFAULT_MAX_MATRIX_MB = 512;
 
-    Action getAction(ActionDoubles strategy) {
-        double r = (double)rand()/RAND_MAX;
-        double cumulativeProb = 0.0;
-        Action finalAction;
-        for (Action a : allActions) {
-            cumulativeProb += strategy[a];
-            if (r < cumulativeProb) {
-                finalAction = a;
-                break;
-            }
-        }
-        return finalAction;
+    BlottoTrainer(int soldiers = 5, int battlefields = 3, long maxMatrixMB = DEFAULT_MAX_MATRIX_MB)
+        : BlottoTrainer(battlefields, enumerateActions(soldiers, battlefields, maxMatrixMB)) {}
+
+    int numActions() const {
+        return NormalFormCFR::numActions(0);
     }
 
-    void train(int iterations) {
-        ActionDoubles actionUtility;
-        ActionDoubles myStrategy, oppStrategy;
-        for (int i=0; i<iterations; i++) {
-            myStrategy = getStrategy(m_regretSum);
-            oppStrategy = getStrategy(m_oppRegretSum);
-            Action myAction = getAction(myStrategy);
-            Action oppAction = getAction(oppStrategy);
-
-            actionUtility = getActionUtility(oppAction);
-            for (Action a : allActions) {
-                m_regretSum[a] += actionUtility[a] - actionUtility[myAction];
-                m_strategySum[a] += myStrategy[a];
-            }
-
-            actionUtility = getActionUtility(myAction);
-            for (Action a : allActions) {
-                m_oppRegretSum[a] += actionUtility[a] - actionUtility[oppAction];
-                oppStrategy[a] += oppStrategy[a];
-            }
-        }
+    int numBattlefields() const {
+        return N;
     }
 
-    ActionDoubles getAverageStrategy() {
-        return getStrategy(m_strategySum);
+    // soldiers that action a sends to each battlefield
+    const int *action(int a) const {
+        return &m_actions[(size_t)a*N];
     }
 
 private:
+    int N;
+    std::vector<int> m_actions;     // N soldier counts per action
+
+    BlottoTrainer(int battlefields, std::vector<int> actions)
+        : NormalFormCFR(PayoffMatrix<int8_t>::generate(actions.size() / battlefields, actions.size() / battlefields,
+                                                       [&](int a, int b) {
+                                                           return battleUtility(&actions[a*battlefields],
+                                                                                &actions[b*battlefields],
+                                                                                battlefields);
+                                                       }),
+                        GameId::ColonelBlotto),
+          N(battlefields), m_actions(std::move(actions)) {}
+
+    // The soldier counts of every way to split `soldiers` over
+    // `battlefields`, in lexicographic order. There are C(S+N-1, N-1) of
+    // them; they are counted in floating point first so that a huge game
+    // is refused instead of overflowing.
+    static std::vector<int> enumerateActions(int soldiers, int battlefields, long maxMatrixMB) {
+        if (soldiers < 1 || battlefields < 2)
+            throw std::runtime_error("Blotto needs at least one soldier and two battlefields");
+        double numActions = 1.0;
+        for (int k=1; k<battlefields; k++)
+            numActions = numActions * (soldiers + k) / k;
+        double matrixMB = 2 * numActions * numActions / (1 << 20);
+        if (matrixMB > maxMatrixMB) {
+            std::ostringstream message;
+            message << soldiers << " soldiers over " << battlefields << " battlefields have " << numActions
+                    << " actions and " << matrixMB << " MiB of utility matrices (limit " << maxMatrixMB << " MiB)";
+            throw std::runtime_error(message.str());
+        }
+        std::vector<int> actions, action(battlefields);
+        addActions(actions, action, 0, soldiers);
+        return actions;
+    }
 
-    ActionDoubles getStrategy(ActionDoubles regretSum) {
-        double normalizingSum = 0.0;
-        ActionDoubles strategy;
-        for (Action a : allActions) {
-            strategy[a] = regretSum[a] > 0 ? regretSum[a] : 0;
-            normalizingSum += strategy[a];
+    // appends every split of `soldiers` over battlefields field.. to actions
+    static void addActions(std::vector<int> &actions, std::vector<int> &action, int field, int soldiers) {
+        if (field == (int)action.size() - 1) {
+            action[field] = soldiers;
+            actions.insert(actions.end(), action.begin(), action.end());
+            return;
         }
-        for (Action a : allActions) {
-            if (normalizingSum > 0) {
-                strategy[a] /= normalizingSum;
-            } else {
-                strategy[a] = 1.0 / allActions.size();
-            }
+        for (int n=0; n<=soldiers; n++) {
+            action[field] = n;
+            addActions(actions, action, field + 1, soldiers - n);
         }
-        return strategy;
     }
 
-    ActionDoubles getActionUtility(Action oppAction) {
-        ActionDoubles actionUtilty;
-        int nBattlesWon;
-        int nBattlesOppWon;
-        for (Action a : allActions) {
-            nBattlesWon = 0;
-            nBattlesOppWon = 0;
-            for (int battle = 0; battle < N; battle++) {
-                if (oppAction[battle] < a[battle])
-                    nBattlesWon++;
-                else if (oppAction[battle] > a[battle])
-                    nBattlesOppWon++;
-            }
-            if (nBattlesWon > nBattlesOppWon)
-                actionUtilty[a] = 1;
-            else if (nBattlesWon < nBattlesOppWon)
-                actionUtilty[a] = -1;
-            else
-                actionUtilty[a] = 0;
+    static int battleUtility(const int *action, const int *oppAction, int battlefields) {
+        int nBattlesWon = 0, nBattlesOppWon = 0;
+        for (int battle=0; battle<battlefields; battle++) {
+            if (oppAction[battle] < action[battle])
+                nBattlesWon++;
+            else if (oppAction[battle] > action[battle])
+                nBattlesOppWon++;
         }
-        return actionUtilty;
+        if (nBattlesWon > nBattlesOppWon)
+            return 1;
+        else if (nBattlesWon < nBattlesOppWon)
+            return -1;
+        return 0;
     }
-
 };
 
 
-int main() {
-    BlottoTrainer trainer = BlottoTrainer();
-    trainer.train(1000000);
-    ActionDoubles finalStrategy = trainer.getAverageStrategy();
-    for (Action a : trainer.allActions) {
-        std::cout << a[0] << " " << a[1] << " " << a[2] << " : " << finalStrategy[a] << "\n";
+int main(int argc, char **argv) {
+    Options options(argc, argv);
+    try {
+        long iterations = options.getInt("iterations", 1000000);
+        int threads = options.getInt("threads", 0);
+        long syncInterval = options.getInt("sync-interval", 10000);
+
+        if (options.has("scaling")) {
+            int maxThreads = options.getInt("max-threads", std::max(1u, std::thread::hardware_concurrency()));
+            reportScaling<BlottoTrainer>(iterations, syncInterval, maxThreads, ScalingCheck::Strategies,
+                                        options.getDouble("tolerance", 0.1));
+            return 0;
+        }
+
+        int soldiers = options.getInt("soldiers", 5), battlefields = options.getInt("battlefields", 3);
+        long maxMatrixMB = options.getInt("max-matrix-mb", BlottoTrainer::DEFAULT_MAX_MATRIX_MB);
+        if (options.has("write-matrix")) {
+            BlottoTrainer(soldiers, battlefields, maxMatrixMB).matrix().write(options.getString("write-matrix", ""));
+            return 0;
+        }
+        if (options.has("compare-modes")) {
+            reportFullWidthComparison([&] { return BlottoTrainer(soldiers, battlefields, maxMatrixMB); },
+                                      options.getDouble("target-exploitability", 0.001),
+                                      options.getInt("max-iterations", 10000000));
+            return 0;
+        }
+
+        auto setUp = [&](BlottoTrainer &trainer) {
+            if (options.has("seed"))
+                trainer.setSeed(options.getInt("seed", 0));
+            if (options.has("full-width"))
+                trainer.setFullWidthMode(options.has("alternating"));
+            else if (threads > 0)
+                trainer.setThreads(threads, syncInterval);
+        };
+        if (options.has("bench")) {
+            BlottoTrainer trainer(soldiers, battlefields, maxMatrixMB), timed(soldiers, battlefields, maxMatrixMB);
+            setUp(trainer);
+            setUp(timed);
+            // an iteration updates one regret table per player
+            reportBenchmark(trainer, timed, iterations, options.getDouble("seconds", 1.0), 2, 0, 1.0);
+            return 0;
+        }
+
+        BlottoTrainer trainer(soldiers, battlefields, maxMatrixMB);
+        setUp(trainer);
+        if (options.has("resume"))
+            trainer.loadCheckpoint(options.getString("resume", ""));
+        if (options.has("checkpoint"))
+            trainer.setCheckpoint(options.getString("checkpoint", ""), options.getInt("checkpoint-interval", 1000000));
+        if (options.has("eval-interval"))
+            trainer.setEvaluation(options.getInt("eval-interval", 0), options.getDouble("target-exploitability", 0.0),
+                                  options.getString("eval-log", ""));
+        trainer.train(iterations);
+        std::vector<double> finalStrategy = trainer.getAverageStrategy();
+        for (int a=0; a<trainer.numActions(); a++) {
+            for (int battle=0; battle<trainer.numBattlefields(); battle++)
+                std::cout << trainer.action(a)[battle] << " ";
+            std::cout << ": " << finalStrategy[a] << "\n";
+        }
+        std::cout << "Exploitability: " << trainer.exploitability() << " per game\n";
+    } catch (const std::exception &e) {
+        std::cerr << "error: " << e.what() << "\n";
+        return 1;
     }
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,473 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+#include <cerrno>
+#include <iostream>
+#include <algorithm>
+#include <stdexcept>
+#include <unistd.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include "Checkpoint.h"
+
+// Multi-process training. Several trainer processes, each holding a full
+// copy of the node table, walk their own streams of deals and every sync
+// interval exchange what the round changed over a socket. Process 0, the
+// coordinator, adds each process's regret and strategy-sum deltas to its
+// table in rank order, as the threaded merge does, and sends back the
+// merged values of the nodes the round touched, so every replica stays
+// identical and N processes train exactly as N threads would.
+//
+// Addresses containing a '/' are Unix-domain socket paths; anything else is
+// host:port for TCP, e.g. 127.0.0.1:7000. A frame is a DeltaHeader followed
+// by one entry per touched node: its uint32 index and then its regrets and
+// strategy sums as doubles, in the host's byte order.
+
+// First message of every non-coordinator process, checked against the
+// coordinator's own so that mismatched trainers fail at start-up
+struct ClusterHello {
+    static constexpr char MAGIC[8] = {'C', 'F', 'R', 'D', 'I', 'S', 'T', '\0'};
+
+    char magic[8];
+    GameId game;
+    uint32_t policy;
+    uint64_t numNodes;
+    uint32_t numActions;
+    uint32_t rank;
+    uint32_t processes;
+    uint32_t reserved;
+    uint64_t syncInterval;
+};
+
+struct DeltaHeader {
+    uint64_t entries;
+    double util; // summed game value of the round's deals
+};
+
+class Cluster {
+public:
+    // how long the processes of a cluster wait for each other to join
+    static const int JOIN_SECONDS = 30;
+
+    // Joins the cluster of `processes` processes at `address` as `rank`.
+    // Rank 0 listens there and waits for the others, which retry for a
+    // while so that processes can be started in any order. Either gives up
+    // after JOIN_SECONDS.
+    Cluster(const std::string &address, int rank, int processes)
+        : m_address(address), m_rank(rank), m_processes(processes) {
+        if (processes < 1 || rank < 0 || rank >= processes)
+            throw std::runtime_error("rank must be 0 to processes-1");
+        if (rank > 0) {
+            m_peers.push_back(connectTo(address));
+            return;
+        }
+        if (processes == 1)
+            return;
+        using Clock = std::chrono::steady_clock;
+        auto deadline = Clock::now() + std::chrono::seconds(JOIN_SECONDS);
+        int listener = listenOn(address);
+        // the destructor does not run if the constructor throws
+        auto fail = [&](const std::string &problem) {
+            ::close(listener);
+            for (int fd : m_peers)
+                ::close(fd);
+            if (isUnix(address))
+                unlink(address.c_str());
+            throw std::runtime_error(problem);
+        };
+        while ((int)m_peers.size() < processes - 1) {
+            long left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+            pollfd waiting {listener, POLLIN, 0};
+            int ready = left > 0 ? poll(&waiting, 1, left) : 0;
+            if (ready < 0 && errno == EINTR)
+                continue;
+            if (ready == 0)
+                fail("only " + std::to_string(m_peers.size() + 1) + " of " + std::to_string(processes)
+                     + " processes joined at " + address);
+            int fd = ready > 0 ? accept(listener, nullptr, nullptr) : -1;
+            if (fd < 0)
+                fail("cannot accept on " + address);
+            m_peers.push_back(fd);
+        }
+        ::close(listener);
+    }
+
+    ~Cluster() {
+        for (int fd : m_peers)
+            ::close(fd);
+        if (m_rank == 0 && isUnix(m_address))
+            unlink(m_address.c_str());
+    }
+
+    Cluster(const Cluster &) = delete;
+    Cluster &operator=(const Cluster &) = delete;
+
+    int rank() const {
+        return m_rank;
+    }
+
+    int size() const {
+        return m_processes;
+    }
+
+    // bytes this process has sent and received, per sync so far
+    double bytesPerSync() const {
+        return m_syncs > 0 ? (m_bytesSent + m_bytesReceived) / (double)m_syncs : 0.0;
+    }
+
+    // Checks that every process trains the same game, policy and table
+    // shape with the same sync interval, ordering the coordinator's peers
+    // by rank, and sizes the frame buffers so that syncs do not allocate
+    void handshake(GameId game, uint32_t policy, uint64_t numNodes, uint32_t numActions, long syncInterval) {
+        ClusterHello hello {};
+        std::memcpy(hello.magic, ClusterHello::MAGIC, sizeof(hello.magic));
+        hello.game = game;
+        hello.policy = policy;
+        hello.numNodes = numNodes;
+        hello.numActions = numActions;
+        hello.rank = m_rank;
+        hello.processes = m_processes;
+        hello.syncInterval = syncInterval;
+        m_numActions = numActions;
+        m_entryBytes = sizeof(uint32_t) + 2*numActions*sizeof(double);
+        m_buffer.resize(sizeof(DeltaHeader) + numNodes*m_entryBytes);
+        m_touched.assign(numNodes, 0);
+
+        if (m_rank > 0) {
+            sendAll(m_peers[0], &hello, sizeof(hello));
+            return;
+        }
+        std::vector<int> byRank(m_peers.size(), -1);
+        for (int fd : m_peers) {
+            ClusterHello peer;
+            receiveAll(fd, &peer, sizeof(peer));
+            std::string problem;
+            if (std::memcmp(peer.magic, ClusterHello::MAGIC, sizeof(peer.magic)) != 0)
+                problem = "a peer is not a cluster trainer";
+            else if (peer.game != game || peer.policy != policy || peer.numNodes != numNodes
+                     || peer.numActions != numActions)
+                problem = "a peer trains another game or policy";
+            else if (peer.processes != (uint32_t)m_processes || peer.syncInterval != (uint64_t)syncInterval)
+                problem = "a peer has another process count or sync interval";
+            else if (peer.rank < 1 || peer.rank >= (uint32_t)m_processes || byRank[peer.rank-1] >= 0)
+                problem = "peer rank " + std::to_string(peer.rank) + " is out of range or taken";
+            if (!problem.empty())
+                throw std::runtime_error(problem);
+            byRank[peer.rank-1] = fd;
+        }
+        m_peers = byRank;
+        m_bytesSent = m_bytesReceived = 0;
+    }
+
+    // Ends a round: merges every process's `deltas` into `nodes`, returning
+    // the summed `util` of all processes. The caller clears its deltas.
+    // Nodes need regretSum and strategySum arrays.
+    template <typename NodeTable>
+    double sync(NodeTable &nodes, const NodeTable &deltas, double util) {
+        m_syncs++;
+        if (m_rank > 0) {
+            size_t bytes = encode(deltas, util, false);
+            sendAll(m_peers[0], m_buffer.data(), bytes);
+            return receiveFrame(m_peers[0], nodes, false);
+        }
+
+        // the coordinator's own deltas are rank 0's
+        double total = util;
+        for (size_t i=0; i<deltas.size(); i++) {
+            if (isZero(deltas[i]))
+                continue;
+            m_touched[i] = 1;
+            for (uint32_t a=0; a<m_numActions; a++) {
+                nodes[i].regretSum[a] += deltas[i].regretSum[a];
+                nodes[i].strategySum[a] += deltas[i].strategySum[a];
+            }
+        }
+        for (int fd : m_peers)
+            total += receiveFrame(fd, nodes, true);
+        size_t bytes = encode(nodes, total, true);
+        for (int fd : m_peers)
+            sendAll(fd, m_buffer.data(), bytes);
+        return total;
+    }
+
+private:
+    std::string m_address;
+    int m_rank, m_processes;
+    std::vector<int> m_peers; // the coordinator's, by rank, or a process's one coordinator
+    uint32_t m_numActions = 0;
+    size_t m_entryBytes = 0;
+    std::vector<unsigned char> m_buffer;
+    std::vector<char> m_touched;
+    long m_syncs = 0, m_bytesSent = 0, m_bytesReceived = 0;
+
+    static bool isUnix(const std::string &address) {
+        return address.find('/') != std::string::npos;
+    }
+
+    template <typename Node>
+    bool isZero(const Node &node) const {
+        for (uint32_t a=0; a<m_numActions; a++)
+            if ((double)node.regretSum[a] != 0.0 || (double)node.strategySum[a] != 0.0)
+                return false;
+        return true;
+    }
+
+    // Writes a frame of `table` into the buffer: the touched nodes when
+    // `touched`, clearing the marks, or else every nonzero node. Returns
+    // its size in bytes.
+    template <typename NodeTable>
+    size_t encode(const NodeTable &table, double util, bool touched) {
+        unsigned char *p = m_buffer.data() + sizeof(DeltaHeader);
+        DeltaHeader header {0, util};
+        for (size_t i=0; i<table.size(); i++) {
+            if (touched ? !m_touched[i] : isZero(table[i]))
+                continue;
+            m_touched[i] = 0;
+            uint32_t index = i;
+            std::memcpy(p, &index, sizeof(index));
+            p += sizeof(index);
+            for (uint32_t a=0; a<m_numActions; a++, p+=sizeof(double)) {
+                double value = table[i].regretSum[a];
+                std::memcpy(p, &value, sizeof(value));
+            }
+            for (uint32_t a=0; a<m_numActions; a++, p+=sizeof(double)) {
+                double value = table[i].strategySum[a];
+                std::memcpy(p, &value, sizeof(value));
+            }
+            header.entries++;
+        }
+        std::memcpy(m_buffer.data(), &header, sizeof(header));
+        return p - m_buffer.data();
+    }
+
+    // Reads a frame from `fd` and adds its entries to `nodes`, marking them
+    // touched, or when not `add` overwrites the nodes with them. Returns
+    // the frame's util.
+    template <typename NodeTable>
+    double receiveFrame(int fd, NodeTable &nodes, bool add) {
+        DeltaHeader header;
+        receiveAll(fd, &header, sizeof(header));
+        if (header.entries > nodes.size())
+            throw std::runtime_error("malformed delta frame");
+        receiveAll(fd, m_buffer.data(), header.entries*m_entryBytes);
+        const unsigned char *p = m_buffer.data();
+        for (uint64_t e=0; e<header.entries; e++) {
+            uint32_t index;
+            std::memcpy(&index, p, sizeof(index));
+            p += sizeof(index);
+            if (index >= nodes.size())
+                throw std::runtime_error("malformed delta frame");
+            m_touched[index] = add;
+            for (uint32_t a=0; a<m_numActions; a++, p+=sizeof(double)) {
+                double value;
+                std::memcpy(&value, p, sizeof(value));
+                if (add)
+                    nodes[index].regretSum[a] += value;
+                else
+                    nodes[index].regretSum[a] = value;
+            }
+            for (uint32_t a=0; a<m_numActions; a++, p+=sizeof(double)) {
+                double value;
+                std::memcpy(&value, p, sizeof(value));
+                if (add)
+                    nodes[index].strategySum[a] += value;
+                else
+                    nodes[index].strategySum[a] = value;
+            }
+        }
+        return header.util;
+    }
+
+    void sendAll(int fd, const void *data, size_t size) {
+        const char *p = static_cast<const char *>(data);
+        for (size_t sent = 0; sent < size; ) {
+            ssize_t n = send(fd, p + sent, size - sent, MSG_NOSIGNAL);
+            if (n <= 0)
+                throw std::runtime_error("lost connection to a cluster process");
+            sent += n;
+        }
+        m_bytesSent += size;
+    }
+
+    void receiveAll(int fd, void *data, size_t size) {
+        char *p = static_cast<char *>(data);
+        for (size_t received = 0; received < size; ) {
+            ssize_t n = recv(fd, p + received, size - received, 0);
+            if (n <= 0)
+                throw std::runtime_error("lost connection to a cluster process");
+            received += n;
+        }
+        m_bytesReceived += size;
+    }
+
+    // Resolves `address` and calls bindOrConnect(fd, addr, length) on a new
+    // socket for it, returning the socket or -1 if that failed
+    template <typename Action>
+    static int openSocket(const std::string &address, Action bindOrConnect) {
+        if (isUnix(address)) {
+            sockaddr_un addr {};
+            addr.sun_family = AF_UNIX;
+            if (address.size() >= sizeof(addr.sun_path))
+                throw std::runtime_error("socket path too long: " + address);
+            std::strcpy(addr.sun_path, address.c_str());
+            int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+            if (fd >= 0 && !bindOrConnect(fd, (sockaddr *)&addr, sizeof(addr))) {
+                ::close(fd);
+                fd = -1;
+            }
+            return fd;
+        }
+        size_t colon = address.rfind(':');
+        if (colon == std::string::npos)
+            throw std::runtime_error("cluster address is neither a socket path nor host:port: " + address);
+        addrinfo hints {}, *info;
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        if (getaddrinfo(address.substr(0, colon).c_str(), address.substr(colon + 1).c_str(), &hints, &info) != 0)
+            throw std::runtime_error("cannot resolve " + address);
+        int fd = socket(info->ai_family, SOCK_STREAM, 0);
+        if (fd >= 0) {
+            int one = 1;
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+            // frames are sent whole and answered, so do not wait to coalesce
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            if (!bindOrConnect(fd, info->ai_addr, info->ai_addrlen)) {
+                ::close(fd);
+                fd = -1;
+            }
+        }
+        freeaddrinfo(info);
+        return fd;
+    }
+
+    int listenOn(const std::string &address) {
+        if (isUnix(address))
+            unlink(address.c_str());
+        int fd = openSocket(address, [this](int fd, const sockaddr *addr, socklen_t length) {
+            return bind(fd, addr, length) == 0 && listen(fd, m_processes) == 0;
+        });
+        if (fd < 0)
+            throw std::runtime_error("cannot listen on " + address);
+        return fd;
+    }
+
+    static int connectTo(const std::string &address) {
+        using Clock = std::chrono::steady_clock;
+        auto start = Clock::now();
+        while (true) {
+            int fd = openSocket(address, [](int fd, const sockaddr *addr, socklen_t length) {
+                return connect(fd, addr, length) == 0;
+            });
+            if (fd >= 0) {
+                int one = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                return fd;
+            }
+            if (Clock::now() - start > std::chrono::seconds(JOIN_SECONDS))
+                throw std::runtime_error("cannot connect to " + address);
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+};
+
+// Trains a fresh Trainer for `iterations` iterations serially and then as
+// 1, 2, 4, ... maxProcesses local processes forked from this one, meeting
+// at `address`, printing as CSV the iterations/second, the speedup over the
+// serial run, the bytes the coordinator sent and received per sync, the
+// average game value, and how far the average strategies end up from a
+// single process with as many threads, which they should match exactly.
+//
+// Trainer needs setCluster(cluster, syncInterval), setThreads(threads,
+// syncInterval), iterate(n) returning the summed game value and
+// getAverageStrategies().
+template <typename Trainer>
+void reportDistributedScaling(long iterations, long syncInterval, int maxProcesses, const std::string &address) {
+    using Clock = std::chrono::steady_clock;
+    std::vector<int> processCounts {0};
+    for (int processes=1; processes<maxProcesses; processes*=2)
+        processCounts.push_back(processes);
+    processCounts.push_back(maxProcesses);
+
+    double serialRate = 0.0;
+    std::cout << "processes,iterations_per_second,speedup,bytes_per_sync,game_value,difference_from_threads\n";
+    for (int processes : processCounts) {
+        if (processes == 0) {
+            Trainer trainer;
+            auto start = Clock::now();
+            double value = trainer.iterate(iterations) / iterations;
+            serialRate = iterations / std::chrono::duration<double>(Clock::now() - start).count();
+            std::cout << "serial," << serialRate << ",1,0," << value << ",0\n";
+            continue;
+        }
+
+        std::cout.flush();
+        std::vector<pid_t> children;
+        for (int rank=1; rank<processes; rank++) {
+            pid_t pid = fork();
+            if (pid < 0)
+                throw std::runtime_error("cannot fork");
+            if (pid == 0) {
+                int status = 0;
+                try {
+                    Trainer trainer;
+                    Cluster cluster(address, rank, processes);
+                    trainer.setCluster(cluster, syncInterval);
+                    trainer.iterate(iterations);
+                } catch (const std::exception &e) {
+                    std::cerr << "error: process " << rank << ": " << e.what() << "\n";
+                    status = 1;
+                }
+                _exit(status);
+            }
+            children.push_back(pid);
+        }
+
+        // the coordinator, whose trainer does not outlive its cluster
+        double value = 0.0, seconds = 0.0, bytesPerSync = 0.0;
+        std::vector<double> strategies;
+        std::string failure;
+        try {
+            Trainer trainer;
+            Cluster cluster(address, 0, processes);
+            trainer.setCluster(cluster, syncInterval);
+            auto start = Clock::now();
+            value = trainer.iterate(iterations) / iterations;
+            seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            bytesPerSync = cluster.bytesPerSync();
+            strategies = trainer.getAverageStrategies();
+        } catch (const std::exception &e) {
+            failure = e.what();
+        }
+        bool childFailed = false;
+        for (pid_t pid : children) {
+            int status;
+            if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+                childFailed = true;
+        }
+        if (childFailed)
+            throw std::runtime_error("a cluster process failed");
+        if (!failure.empty())
+            throw std::runtime_error(failure);
+
+        Trainer threaded;
+        threaded.setThreads(processes, syncInterval);
+        threaded.iterate(iterations);
+        std::vector<double> reference = threaded.getAverageStrategies();
+        double difference = 0.0;
+        for (size_t i=0; i<strategies.size(); i++)
+            difference = std::max(difference, std::fabs(strategies[i] - reference[i]));
+        double rate = iterations / seconds;
+        std::cout << processes << "," << rate << "," << rate/serialRate << "," << bytesPerSync << "," << value << ","
+                  << difference << "\n";
+    }
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include <cstdio>
+#include <chrono>
+#include <string>
+#include <iostream>
+#include <algorithm>
+#include <stdexcept>
+
+// Trains a fresh trainer from makeTrainer() of a matrix game by sampling an
+// action per player per iteration, then full width with simultaneous and
+// with alternating updates, until the exploitability of its average
+// strategies is below `target` or for at most maxIterations iterations,
+// printing as CSV how many iterations and seconds that took. Exploitability
+// is checked after batches of 2% of the iterations so far. Trainers need
+// iterate(n), exploitability() and setFullWidthMode(alternating).
+template <typename MakeTrainer>
+void reportFullWidthComparison(MakeTrainer makeTrainer, double target, long maxIterations) {
+    using Clock = std::chrono::steady_clock;
+    std::cout << "method,iterations,seconds,exploitability,reached_target\n";
+    for (const char *method : {"sampled", "simultaneous", "alternating"}) {
+        auto trainer = makeTrainer();
+        if (method != std::string("sampled"))
+            trainer.setFullWidthMode(method == std::string("alternating"));
+        long iterations = 0;
+        double elapsed = 0.0, exploitability = 0.0;
+        while (iterations < maxIterations) {
+            long batch = std::min(maxIterations - iterations, std::max(1L, iterations / 50));
+            auto start = Clock::now();
+            trainer.iterate(batch);
+            elapsed += std::chrono::duration<double>(Clock::now() - start).count();
+            iterations += batch;
+            exploitability = trainer.exploitability();
+            if (exploitability < target)
+                break;
+        }
+        std::cout << method << "," << iterations << "," << elapsed << "," << exploitability << ","
+                  << (exploitability < target ? "yes" : "no") << "\n";
+    }
+}
+
+// Evaluates exploitability every `interval` training iterations while a
+// trainer's train() runs, printing each value and optionally appending it
+// to a CSV log, and reports when it has dropped below a target so that
+// training can stop early. Without a call to configure() it does nothing.
+//
+// train() runs at most steps() iterations at a time, so that evaluations
+// land exactly on multiples of the interval, and calls update() after each.
+class ExploitabilityMonitor {
+public:
+    ExploitabilityMonitor() = default;
+    ExploitabilityMonitor(const ExploitabilityMonitor &) = delete;
+    ExploitabilityMonitor &operator=(const ExploitabilityMonitor &) = delete;
+
+    ~ExploitabilityMonitor() {
+        if (m_log)
+            std::fclose(m_log);
+    }
+
+    // `iterations` is how many the trainer has already run, e.g. when it
+    // was resumed from a checkpoint. A target of 0 never stops training.
+    void configure(long interval, double target, const std::string &logPath, long iterations) {
+        if (interval <= 0)
+            throw std::runtime_error("exploitability interval must be positive");
+        m_interval = interval;
+        m_target = target;
+        m_next = (iterations / interval + 1) * interval;
+        m_start = Clock::now();
+        if (!logPath.empty()) {
+            m_log = std::fopen(logPath.c_str(), "w");
+            if (!m_log)
+                throw std::runtime_error("cannot write exploitability log " + logPath);
+            std::fprintf(m_log, "iterations,seconds,exploitability\n");
+        }
+    }
+
+    // how many of the next `limit` iterations can run before an evaluation
+    long steps(long iterations, long limit) const {
+        return m_interval ? std::min(limit, m_next - iterations) : limit;
+    }
+
+    // Evaluates if one is due after `iterations` iterations. Returns true
+    // once exploitability is below the target.
+    template <typename Evaluate>
+    bool update(long iterations, const char *unit, Evaluate evaluate) {
+        if (!m_interval || iterations < m_next)
+            return false;
+        m_next += m_interval;
+        double value = evaluate();
+        double seconds = std::chrono::duration<double>(Clock::now() - m_start).count();
+        std::cout << "Exploitability after " << iterations << " iterations: " << value << " " << unit << "\n";
+        if (m_log) {
+            std::fprintf(m_log, "%ld,%g,%g\n", iterations, seconds, value);
+            std::fflush(m_log);
+        }
+        if (m_target > 0 && value < m_target) {
+            std::cout << "Reached target exploitability of " << m_target << " " << unit << "\n";
+            return true;
+        }
+        return false;
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+    long m_interval = 0, m_next = 0;
+    double m_target = 0.0;
+    Clock::time_point m_start;
+    FILE *m_log = nullptr;
+};
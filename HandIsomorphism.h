@@ -0,0 +1,260 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <iostream>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+
+// Hand isomorphism: maps the cards dealt in a sequence of rounds (e.g. two
+// hole cards, then a flop) to a dense index of their equivalence class, so
+// that equivalent situations share one node.
+//
+// Cards are rank*numSuits + suit. Two deals are equivalent when they only
+// differ in the order of the cards within a round and, for suited games,
+// by a relabelling of the suits. In a game where suits never matter (the
+// Kuhn variants, whose "suits" are copies of a value) only the ranks dealt
+// in each round count.
+//
+// Every deal is ranked as a set of cards per round, in colexicographic
+// order, and a table built once maps that raw rank to its class, so
+// indexing costs a few table loads per deal and none per node visit.
+// Classes are numbered in the order of their canonical deals; for one
+// round of two suitless cards that is 11, 12, 22, 13, 23, 33, ... as in
+// handIndex() of KuhnPokerTwoCards.cpp.
+class HandIndexer {
+public:
+    static const int MAX_CARDS = 64;
+
+    HandIndexer(int numRanks, int numSuits, std::vector<int> rounds, bool suited)
+        : m_numRanks(numRanks), m_numSuits(numSuits), m_numCards(numRanks*numSuits), m_rounds(std::move(rounds)),
+          m_suited(suited) {
+        if (numRanks < 1 || numSuits < 1 || m_numCards > MAX_CARDS)
+            throw std::runtime_error("hand indexer decks have 1 to " + std::to_string(MAX_CARDS) + " cards");
+        for (int n=0; n<=m_numCards; n++)
+            for (int k=0; k<=MAX_ROUND_CARDS; k++)
+                m_binomial[n][k] = k == 0 ? 1 : n == 0 ? 0 : m_binomial[n-1][k-1] + m_binomial[n-1][k];
+        long rawSize = 1;
+        for (int k : m_rounds) {
+            if (k < 1 || k > MAX_ROUND_CARDS)
+                throw std::runtime_error("hand indexer rounds deal 1 to " + std::to_string(MAX_ROUND_CARDS) + " cards");
+            m_numDealt += k;
+            rawSize *= m_binomial[m_numCards][k];
+            if (rawSize > MAX_RAW_SIZE)
+                throw std::runtime_error("too many deals for a hand indexer table");
+        }
+        if (m_numDealt > m_numCards)
+            throw std::runtime_error("hand indexer rounds deal more cards than the deck holds");
+
+        // rank every deal, then number the distinct canonical deals
+        m_classes.assign(rawSize, -1);
+        std::vector<int> cards(m_numDealt);
+        std::vector<long> canonical;
+        forEachDeal(cards, 0, 0, [&](long) {
+            canonical.push_back(canonicalRaw(cards.data()));
+        });
+        std::sort(canonical.begin(), canonical.end());
+        canonical.erase(std::unique(canonical.begin(), canonical.end()), canonical.end());
+        forEachDeal(cards, 0, 0, [&](long raw) {
+            m_classes[raw] = std::lower_bound(canonical.begin(), canonical.end(), canonicalRaw(cards.data()))
+                           - canonical.begin();
+        });
+        m_representatives.resize(canonical.size() * m_numDealt);
+        for (size_t c=0; c<canonical.size(); c++)
+            unrank(canonical[c], &m_representatives[c * m_numDealt]);
+    }
+
+    int numRanks() const { return m_numRanks; }
+    int numSuits() const { return m_numSuits; }
+    int numCards() const { return m_numCards; }
+    int numDealt() const { return m_numDealt; }
+    const std::vector<int> &rounds() const { return m_rounds; }
+
+    // number of classes
+    int size() const {
+        return m_representatives.size() / m_numDealt;
+    }
+
+    // class of the cards of every round in turn, numDealt() in all
+    int index(const int *cards) const {
+        return m_classes[rawIndex(cards)];
+    }
+
+    // the canonical deal of class c, numDealt() cards
+    const int *representative(int c) const {
+        return &m_representatives[c * m_numDealt];
+    }
+
+    // Colexicographic rank of the set of cards dealt in each round, as the
+    // digits of one number with the first round most significant. -1 if a
+    // card is dealt twice.
+    long rawIndex(const int *cards) const {
+        long raw = 0;
+        uint64_t dealt = 0;
+        for (int k : m_rounds) {
+            int sorted[MAX_ROUND_CARDS];
+            for (int i=0; i<k; i++) {
+                int card = cards[i], j = i;
+                if (dealt & (uint64_t)1 << card)
+                    return -1;
+                dealt |= (uint64_t)1 << card;
+                for (; j > 0 && sorted[j-1] > card; j--)
+                    sorted[j] = sorted[j-1];
+                sorted[j] = card;
+            }
+            long colex = 0;
+            for (int i=0; i<k; i++)
+                colex += m_binomial[sorted[i]][i+1];
+            raw = raw * m_binomial[m_numCards][k] + colex;
+            cards += k;
+        }
+        return raw;
+    }
+
+    // The raw index of the canonical deal equivalent to `cards`. Suitless,
+    // each rank's cards take suits 0, 1, ... in the order they are dealt.
+    // Suited, it is the least raw index over all relabellings of the suits.
+    long canonicalRaw(const int *cards) const {
+        std::vector<int> mapped(m_numDealt);
+        if (!m_suited) {
+            std::vector<int> copies(m_numRanks, 0);
+            for (int i=0; i<m_numDealt; i++) {
+                int rank = cards[i] / m_numSuits;
+                mapped[i] = rank*m_numSuits + copies[rank]++;
+            }
+            return rawIndex(mapped.data());
+        }
+        std::vector<int> permutation(m_numSuits);
+        for (int s=0; s<m_numSuits; s++)
+            permutation[s] = s;
+        long best = -1;
+        do {
+            for (int i=0; i<m_numDealt; i++)
+                mapped[i] = cards[i] / m_numSuits * m_numSuits + permutation[cards[i] % m_numSuits];
+            long raw = rawIndex(mapped.data());
+            if (best < 0 || raw < best)
+                best = raw;
+        } while (std::next_permutation(permutation.begin(), permutation.end()));
+        return best;
+    }
+
+    // Calls f(raw) for every deal, with `cards` holding it
+    template <typename F>
+    void forEachDeal(std::vector<int> &cards, size_t round, long raw, F f) const {
+        if (round == m_rounds.size()) {
+            f(raw);
+            return;
+        }
+        int first = 0;
+        for (size_t r=0; r<round; r++)
+            first += m_rounds[r];
+        int k = m_rounds[round];
+        // the k-subsets of the deck in colex order, skipping dealt cards
+        std::vector<int> subset(k);
+        for (int i=0; i<k; i++)
+            subset[i] = i;
+        for (long colex = 0; ; colex++) {
+            bool clash = false;
+            for (int i=0; i<k; i++) {
+                cards[first + i] = subset[i];
+                clash |= std::find(cards.begin(), cards.begin() + first, subset[i]) != cards.begin() + first;
+            }
+            if (!clash)
+                forEachDeal(cards, round + 1, raw * m_binomial[m_numCards][k] + colex, f);
+            int i = 0;
+            while (i < k - 1 && subset[i] + 1 == subset[i+1])
+                i++;
+            if (++subset[i] >= m_numCards)
+                break;
+            for (int j=0; j<i; j++)
+                subset[j] = j;
+        }
+    }
+
+private:
+    static const int MAX_ROUND_CARDS = 8;
+    static const long MAX_RAW_SIZE = 1L << 28;
+
+    int m_numRanks, m_numSuits, m_numCards, m_numDealt = 0;
+    std::vector<int> m_rounds;
+    bool m_suited;
+    long m_binomial[MAX_CARDS+1][MAX_ROUND_CARDS+1];
+    std::vector<int> m_classes, m_representatives;
+
+    // the cards of raw index `raw`, each round in increasing order
+    void unrank(long raw, int *cards) const {
+        int end = m_numDealt;
+        for (int r=m_rounds.size()-1; r>=0; r--) {
+            int k = m_rounds[r];
+            long colex = raw % m_binomial[m_numCards][k];
+            raw /= m_binomial[m_numCards][k];
+            end -= k;
+            int card = m_numCards;
+            for (int i=k-1; i>=0; i--) {
+                do
+                    card--;
+                while (m_binomial[card][i+1] > colex);
+                cards[end + i] = card;
+                colex -= m_binomial[card][i+1];
+            }
+        }
+    }
+};
+
+// Checks by enumerating every deal that `indexer` is a bijection from
+// classes of equivalent deals onto 0..size()-1: each deal indexes to the
+// class whose representative is equivalent to it, and each representative
+// indexes to its own class, so no two classes share an index. Throws a
+// description of the first failure.
+inline void checkHandIndexer(const HandIndexer &indexer) {
+    std::vector<bool> seen(indexer.size(), false);
+    std::vector<int> cards(indexer.numDealt());
+    indexer.forEachDeal(cards, 0, 0, [&](long raw) {
+        if (indexer.rawIndex(cards.data()) != raw)
+            throw std::runtime_error("raw index of deal " + std::to_string(raw) + " is inconsistent");
+        int c = indexer.index(cards.data());
+        if (c < 0 || c >= indexer.size())
+            throw std::runtime_error("deal " + std::to_string(raw) + " has no class");
+        if (indexer.canonicalRaw(indexer.representative(c)) != indexer.canonicalRaw(cards.data()))
+            throw std::runtime_error("deal " + std::to_string(raw) + " is not equivalent to its class");
+        seen[c] = true;
+    });
+    for (int c=0; c<indexer.size(); c++) {
+        if (!seen[c])
+            throw std::runtime_error("class " + std::to_string(c) + " has no deal");
+        if (indexer.index(indexer.representative(c)) != c)
+            throw std::runtime_error("representative of class " + std::to_string(c) + " indexes elsewhere");
+    }
+}
+
+// Checks indexers of a few decks and rounds, suitless and suited, printing
+// as CSV how many deals fall into how many classes. Preflop hold'em has the
+// well-known 169 classes.
+inline void reportHandIndexerChecks() {
+    struct Case {
+        int ranks, suits;
+        std::vector<int> rounds;
+        bool suited;
+    };
+    const Case cases[] = {
+        {4, 4, {2}, false},     // two-card Kuhn
+        {4, 2, {1, 1}, false},  // a card and the flop of community-flop Kuhn
+        {12, 4, {2}, false},
+        {13, 4, {2}, true},     // hold'em hole cards
+        {13, 4, {2, 1}, true},
+        {6, 4, {2, 3}, true},
+    };
+    std::cout << "ranks,suits,rounds,suited,deals,classes\n";
+    for (const Case &c : cases) {
+        HandIndexer indexer(c.ranks, c.suits, c.rounds, c.suited);
+        checkHandIndexer(indexer);
+        long deals = 0;
+        std::vector<int> cards(indexer.numDealt());
+        indexer.forEachDeal(cards, 0, 0, [&](long) { deals++; });
+        std::string rounds;
+        for (int k : c.rounds)
+            rounds += (rounds.empty() ? "" : "+") + std::to_string(k);
+        std::cout << c.ranks << "," << c.suits << "," << rounds << "," << (c.suited ? "yes" : "no") << ","
+                  << deals << "," << indexer.size() << "\n";
+    }
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include <array>
+
+// Showdown results between every pair of hands, generated at compile time
+// from a hand ranking. A ranking is any constexpr callable that maps a hand
+// index to its strength, higher being better, so a new variant only has to
+// supply its ranking rule to settle showdowns with a single table load.
+//
+// table[h0][h1] is 1 if hand h0 beats h1, -1 if it loses and 0 on a tie.
+template <int NUM_HANDS, typename Ranking>
+constexpr std::array<std::array<int, NUM_HANDS>, NUM_HANDS> makeShowdownTable(Ranking strength) {
+    std::array<std::array<int, NUM_HANDS>, NUM_HANDS> table {};
+    for (int h0=0; h0<NUM_HANDS; h0++) {
+        for (int h1=0; h1<NUM_HANDS; h1++) {
+            int s0 = strength(h0), s1 = strength(h1);
+            table[h0][h1] = s0 > s1 ? 1 : (s0 < s1 ? -1 : 0);
+        }
+    }
+    return table;
+}
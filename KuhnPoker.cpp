@@ -1,147 +1,81 @@
 #include <iostream>
-#include <random>
 #include <array>
 #include <string>
-#include <map>
-#include <algorithm>
-#include <time.h>
+#include "Options.h"
+#include "PokerCFR.h"
+#include "PublicTree.h"
+#include "HandRanking.h"
+#include "VectorCFR.h"
+#include "Checkpoint.h"
+#include "Rng.h"
 
-class KuhnPokerCFR {
+// Five-card Kuhn poker, trained by the PokerCFR engine. A hand is one of
+// the cards 1-5, with hand index card-1. Actions are bet levels with stakes
+// 1 and 2, so pp and bb are showdowns and bp is a fold.
+struct KuhnPokerGame {
     static const int NUM_ACTIONS = 2;
     static const int PASS = 0, BET = 1;
-public:
-   
-    KuhnPokerCFR() {
-        srand(5);
-    }        
+    static const int NUM_CARDS = 5, NUM_HANDS = NUM_CARDS;
 
-    // NODE CLASS
-private:
-    class Node {
-    public:
-        std::string infoSet;
-        std::array<double, NUM_ACTIONS> regretSum;        
-        std::array<double, NUM_ACTIONS> strategy {0.0};
-        std::array<double, NUM_ACTIONS> strategySum {0.0};
+    // Non-terminal betting histories, in the order of their rows of the
+    // node table
+    static const int NUM_HISTORIES = 4, MAX_POSITION = 5;
+    static const int NUM_POSITIONS = NUM_ACTIONS*MAX_POSITION + 1;
+    static constexpr std::array<const char *, NUM_HISTORIES> HISTORIES {"", "p", "b", "pb"};
+    static const int NUM_INFOSETS = NUM_HISTORIES * NUM_HANDS;
 
-        std::array<double, NUM_ACTIONS> getAverageStrategy() {
-            std::array<double, NUM_ACTIONS> avgStrategy;
-            double normalisingSum = 0.0;
-            for (int a=0; a<NUM_ACTIONS; a++)
-                normalisingSum += strategySum[a];
-            for (int a=0; a<NUM_ACTIONS; a++) {
-                if (normalisingSum > 0)
-                    avgStrategy[a] = strategySum[a] / normalisingSum;
-                else
-                    avgStrategy[a] = 1.0 / NUM_ACTIONS;
-            }
-            return avgStrategy;
-        }
+    static constexpr auto HISTORY_IDS = makeHistoryIds<NUM_ACTIONS, MAX_POSITION>(HISTORIES, "pb");
+    static constexpr auto TERMINALS = makeBetLevelTerminals<NUM_ACTIONS, NUM_POSITIONS>({1, 2});
+    static constexpr auto SUBTREE_SIZES = makeSubtreeSizes<NUM_ACTIONS, NUM_POSITIONS>(TERMINALS);
+    static constexpr int MAX_REGRET_STEP = 2*maxPayoff(TERMINALS);
+    static constexpr auto SHOWDOWN = makeShowdownTable<NUM_HANDS>([](int hand) { return hand; });
 
-        std::array<double, NUM_ACTIONS> getStrategy(double realisationWeight) {
-            double normalisingSum = 0.0;
-            for (int a=0; a<NUM_ACTIONS; a++) {
-                strategy[a] = regretSum[a] > 0 ? regretSum[a] : 0;
-                normalisingSum += strategy[a];
-            }
-            for (int a=0; a<NUM_ACTIONS; a++) {
-                if (normalisingSum > 0)
-                    strategy[a] /= normalisingSum;
-                else
-                    strategy[a] = 1.0 / NUM_ACTIONS;
-                strategySum[a] += realisationWeight * strategy[a];
-            }
-            return strategy;
-        }
+    // probability of dealing hand h0 to player 1 and h1 to player 2
+    static constexpr auto CHANCE = [] {
+        std::array<std::array<double, NUM_HANDS>, NUM_HANDS> chance {};
+        for (int h0=0; h0<NUM_HANDS; h0++)
+            for (int h1=0; h1<NUM_HANDS; h1++)
+                chance[h0][h1] = h0 == h1 ? 0.0 : 1.0 / (NUM_CARDS * (NUM_CARDS-1));
+        return chance;
+    }();
 
-        std::string toString() {
-            std::array<double, NUM_ACTIONS> avgStrategy = getAverageStrategy();
-            std::string res = infoSet + ": [" + std::to_string(avgStrategy[0]) + ", " + std::to_string(avgStrategy[1]) + "]";
-            return res;
-        }
-    };
+    static const GameId ID = GameId::KuhnPoker;
+    static const uint64_t SEED = 5;
+    static const long ITERATIONS = 10000000;
+    static const int SAMPLED_NODES = NUM_HISTORIES;
 
-    std::map<std::string, Node *> m_nodeMap;
+    struct Deal {
+        std::array<int, 2> hands {0};
+    };
 
-// KUHN POKER METHODS:
-public:
-    void train(int iterations) {
-        std::array<int, 5> cards {1, 2, 3, 4, 5};
-        double util = 0.0;
-        for (int i=0; i<iterations; i++) {
-            if (i % 100000 == 0) std::cout << "Starting iteration " << i << ":\n";
-            // shuffle cards
-            std::random_shuffle(cards.begin(), cards.end());
-            util += cfr(cards, "", 1.0, 1.0);
-        }
-        std::cout << "Average game value: " << util/iterations << "\nFinal Strategy:\n";
-        for (auto &n : m_nodeMap) {
-            std::cout << "\t" << n.second->toString() << "\n";
+    // The cards, two of which are shuffled to the front for each deal
+    class Deck {
+    public:
+        void deal(Rng &rng, Deal &deal) {
+            partialShuffle(m_cards.data(), NUM_CARDS, 2, rng);
+            deal.hands = {m_cards[0]-1, m_cards[1]-1};
         }
-    }
 
-private:
-    double cfr(std::array<int, 5> cards, std::string history, double p0, double p1) {
-        int turnIndex = history.length();
-        int player = turnIndex % 2; // player 1 for even turns, player 2 for odd. turns start at 0
-        int opponent = 1 - player;
-        // Return payoff for terminal states
-        if (turnIndex > 1) {
-            bool terminalPass = history.back() == 'p';
-            bool doubleBet = history.substr(turnIndex-2) == "bb";
-            bool isPlayerCardHigher = cards[player] > cards[opponent];
-            if (terminalPass) {
-                if (history.substr(turnIndex-2) == "pp") {
-                    return isPlayerCardHigher ? 1 : -1;
-                } else {
-                    return 1;
-                }
-            } else if (doubleBet) {
-                return isPlayerCardHigher ? 2 : -2;
-            }
-        }
+    private:
+        std::array<int, NUM_CARDS> m_cards {1, 2, 3, 4, 5};
+    };
 
-        // create info set
-        std::string infoSet = std::to_string(cards[player]) + history;
-        
-        // get node or create it if nonexistant
-        Node *node;
-        if (m_nodeMap.find(infoSet) == m_nodeMap.end()) {
-            // node doesn't exist yet
-            node = new Node();
-            node->infoSet = infoSet;
-            m_nodeMap[infoSet] = node;
-        } else
-            node = m_nodeMap[infoSet];
-        
-        // for each action, recursively call cfr with additional history and 
-        // probability
-        std::array<double, NUM_ACTIONS> strategy = node->getStrategy(player == 0 ? p0 : p1);
-        std::array<double, NUM_ACTIONS> util {0.0, 0.0};
-        double nodeUtil = 0.0;
-        for (int a=0; a<NUM_ACTIONS; a++) {
-            std::string nextHistory = history + (a==0 ? "p" : "b");
-            if (player == 0)
-                util[a] = -cfr(cards, nextHistory, p0*strategy[a], p1);
-            else
-                util[a] = -cfr(cards, nextHistory, p0, p1*strategy[a]);
-            nodeUtil += strategy[a] * util[a];
-        }
-        
-        // for each action, compute and accumulate counterfactual regret
-        for (int a=0; a<NUM_ACTIONS; a++) {
-            double regret = util[a] - nodeUtil;
-            node->regretSum[a] += (player == 0 ? p1 : p0) * regret;
-        }
-        
-        return nodeUtil; 
-    }
+    typedef BetLevelHistory<KuhnPokerGame, 3> History;
+    typedef VectorCFR<KuhnPokerGame> Vector;
 
+    static std::string infoSetName(int index) {
+        return std::to_string(index % NUM_HANDS + 1) + HISTORIES[index / NUM_HANDS];
+    }
 };
 
-int main() {
-    KuhnPokerCFR trainer = KuhnPokerCFR();
-    trainer.train(10000000);
+int main(int argc, char **argv) {
+    Options options(argc, argv);
+    try {
+        runPokerTrainer<KuhnPokerGame>(options);
+    } catch (const std::exception &e) {
+        std::cerr << "error: " << e.what() << "\n";
+        return 1;
+    }
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,436 @@
+#include <iostream>
+#include <array>
+#include <string>
+#include <algorithm>
+#include "Options.h"
+#include "PokerCFR.h"
+#include "PublicTree.h"
+#include "RegretPolicy.h"
+#include "Checkpoint.h"
+#include "Rng.h"
+
+// a card that pairs the flop beats any unpaired card, which are compared
+// by value
+constexpr int flopStrength(int hand, int flop) {
+    return hand == flop ? 100 + hand : hand;
+}
+
+class CommunityFlopVectorCFR;
+
+// Kuhn poker with a community card, trained by the PokerCFR engine. Each
+// player is dealt one private card from two copies each of the values 1-4,
+// there is a round of Kuhn betting (ante 1, bet to 2), then a shared flop
+// card is turned and there is a second round in which a bet adds 2 more. A
+// card that pairs the flop beats any unpaired card, and otherwise the
+// higher card wins.
+//
+// The first round ends at a fold or in one of the three calling lines pp,
+// bb and pbb, each of which leads to a chance node dealing the flop and a
+// second betting tree that starts again with the first player. The second
+// round's terminals are bet-level terminals whose stakes start from what
+// the line has already committed, so payoffs stay single table loads. The
+// sampled walk deals the flop with the private cards, so the chance node is
+// only enumerated by the vector engine.
+struct KuhnPokerCommunityFlopGame {
+    static const int NUM_ACTIONS = 2;
+    static const int PASS = 0, BET = 1;
+    static const int NUM_VALUES = 4, COPIES = 2, NUM_CARDS = NUM_VALUES*COPIES;
+    static const int NUM_HANDS = NUM_VALUES; // a hand is its card value - 1
+
+    // Betting histories of one round, the same in both rounds
+    static const int NUM_HISTORIES = 4, MAX_POSITION = 5;
+    static const int NUM_POSITIONS = NUM_ACTIONS*MAX_POSITION + 1;
+    static constexpr std::array<const char *, NUM_HISTORIES> HISTORIES {"", "p", "b", "pb"};
+    static constexpr auto HISTORY_IDS = makeHistoryIds<NUM_ACTIONS, MAX_POSITION>(HISTORIES, "pb");
+
+    // first-round calls, which go on to the flop, and their stakes
+    static const int NUM_LINES = 3;
+    static constexpr std::array<const char *, NUM_LINES> LINES {"pp", "bb", "pbb"};
+    static constexpr std::array<int, NUM_LINES> LINE_STAKES {1, 2, 2};
+    static constexpr auto LINE_IDS = makeHistoryIds<NUM_ACTIONS, NUM_POSITIONS>(LINES, "pb");
+
+    static constexpr auto PREFLOP_TERMINALS = makeBetLevelTerminals<NUM_ACTIONS, NUM_POSITIONS>({1, 2});
+    static constexpr std::array<std::array<Terminal, NUM_POSITIONS>, NUM_LINES> FLOP_TERMINALS {
+        makeBetLevelTerminals<NUM_ACTIONS, NUM_POSITIONS>({1, 3}),
+        makeBetLevelTerminals<NUM_ACTIONS, NUM_POSITIONS>({2, 4}),
+        makeBetLevelTerminals<NUM_ACTIONS, NUM_POSITIONS>({2, 4}),
+    };
+
+    // Information sets are (hand, history) in the first round, stored at
+    // historyId*NUM_HANDS + hand, and (hand, line, flop, history) in the
+    // second, stored after them
+    static const int PREFLOP_INFOSETS = NUM_HISTORIES * NUM_HANDS;
+    static const int NUM_INFOSETS = PREFLOP_INFOSETS + NUM_LINES*NUM_VALUES*NUM_HISTORIES*NUM_HANDS;
+
+    static constexpr int flopInfoset(int line, int flop, int historyId, int hand) {
+        return PREFLOP_INFOSETS + ((line*NUM_VALUES + flop)*NUM_HISTORIES + historyId)*NUM_HANDS + hand;
+    }
+
+    // SHOWDOWN[flop][h0][h1]: 1 if h0 beats h1 on this flop, -1 if it loses
+    static constexpr auto SHOWDOWN = [] {
+        std::array<std::array<std::array<int, NUM_HANDS>, NUM_HANDS>, NUM_VALUES> showdown {};
+        for (int f=0; f<NUM_VALUES; f++)
+            for (int h0=0; h0<NUM_HANDS; h0++)
+                for (int h1=0; h1<NUM_HANDS; h1++) {
+                    int s0 = flopStrength(h0, f), s1 = flopStrength(h1, f);
+                    showdown[f][h0][h1] = s0 > s1 ? 1 : (s0 < s1 ? -1 : 0);
+                }
+        return showdown;
+    }();
+
+    // CHANCE[flop][h0][h1]: probability of dealing h0 to player 1, h1 to
+    // player 2 and then the flop
+    static constexpr auto CHANCE = [] {
+        std::array<std::array<std::array<double, NUM_HANDS>, NUM_HANDS>, NUM_VALUES> chance {};
+        const double deals = NUM_CARDS * (NUM_CARDS-1) * (NUM_CARDS-2);
+        for (int f=0; f<NUM_VALUES; f++)
+            for (int h0=0; h0<NUM_HANDS; h0++)
+                for (int h1=0; h1<NUM_HANDS; h1++)
+                    chance[f][h0][h1] = COPIES * (COPIES - (h1==h0)) * (COPIES - (f==h0) - (f==h1)) / deals;
+        return chance;
+    }();
+
+    // Decision points one sampled walk visits below each first-round trie
+    // position, counting the second round of every calling line below it
+    static constexpr auto FLOP_SUBTREE_SIZES = makeSubtreeSizes<NUM_ACTIONS, NUM_POSITIONS>(FLOP_TERMINALS[0]);
+    static constexpr auto SUBTREE_SIZES = [] {
+        std::array<int, NUM_POSITIONS> sizes = makeSubtreeSizes<NUM_ACTIONS, NUM_POSITIONS>(PREFLOP_TERMINALS);
+        // children always have higher positions than their parents
+        for (int pos=NUM_POSITIONS-1; pos>=0; pos--) {
+            if (PREFLOP_TERMINALS[pos].showdownStake) {
+                sizes[pos] = FLOP_SUBTREE_SIZES[0];
+            } else if (sizes[pos]) {
+                sizes[pos] = 1;
+                for (int a=0; a<NUM_ACTIONS && NUM_ACTIONS*pos + 1 + a < NUM_POSITIONS; a++)
+                    sizes[pos] += sizes[NUM_ACTIONS*pos + 1 + a];
+            }
+        }
+        return sizes;
+    }();
+    static constexpr int MAX_REGRET_STEP = 2*std::max({maxPayoff(PREFLOP_TERMINALS), maxPayoff(FLOP_TERMINALS[0]),
+                                                       maxPayoff(FLOP_TERMINALS[1]), maxPayoff(FLOP_TERMINALS[2])});
+
+    static const GameId ID = GameId::KuhnPokerCommunityFlop;
+    static const uint64_t SEED = 13;
+    static const long ITERATIONS = 10000000;
+    static const int SAMPLED_NODES = NUM_HISTORIES * (1 + NUM_LINES);
+
+    struct Deal {
+        std::array<int, 2> hands {0};
+        int flop = 0;
+        // showdown result of the hands on the flop, for the first player,
+        // looked up once per deal rather than at every showdown
+        int showdown = 0;
+    };
+
+    // The cards, two private cards and the flop of which are shuffled to
+    // the front for each deal
+    class Deck {
+    public:
+        void deal(Rng &rng, Deal &deal) {
+            partialShuffle(m_cards.data(), NUM_CARDS, 3, rng);
+            deal.hands = {m_cards[0], m_cards[1]};
+            deal.flop = m_cards[2];
+            deal.showdown = SHOWDOWN[deal.flop][deal.hands[0]][deal.hands[1]];
+        }
+
+    private:
+        std::array<int, NUM_CARDS> m_cards {0, 0, 1, 1, 2, 2, 3, 3};
+    };
+
+    // The public history of both rounds: the trie position of every depth
+    // and, once a call has dealt the flop, the calling line and the depth at
+    // which the second round starts. A call pushes straight to the root of
+    // the second round, where the first player acts again.
+    class History {
+    public:
+        static const int MAX_DEPTH = 6; // pbb, then pbb again on the flop
+
+        void push(int action) {
+            int pos = NUM_ACTIONS*m_positions[m_depth] + 1 + action;
+            m_depth++;
+            if (m_flopDepth == 0 && PREFLOP_TERMINALS[pos].showdownStake) {
+                m_line = LINE_IDS[pos];
+                m_flopDepth = m_depth;
+                pos = 0;
+            }
+            m_positions[m_depth] = pos;
+        }
+
+        void pop() {
+            if (m_depth == m_flopDepth)
+                m_flopDepth = 0;
+            m_depth--;
+        }
+
+        int depth() const {
+            return m_depth;
+        }
+
+        // each round starts with the first player
+        int player() const {
+            return (m_depth - m_flopDepth) % 2;
+        }
+
+        bool isTerminal() const {
+            return terminal().terminal;
+        }
+
+        // payoff of a terminal history for the player to act
+        double payoff(const Deal &deal) const {
+            const Terminal &t = terminal();
+            return t.foldPayoff + t.showdownStake*(player() == 0 ? deal.showdown : -deal.showdown);
+        }
+
+        int infoset(const Deal &deal) const {
+            int pos = m_positions[m_depth], hand = deal.hands[player()];
+            if (m_flopDepth == 0)
+                return HISTORY_IDS[pos]*NUM_HANDS + hand;
+            return flopInfoset(m_line, deal.flop, HISTORY_IDS[pos], hand);
+        }
+
+        int subtreeSize(int action) const {
+            int child = NUM_ACTIONS*m_positions[m_depth] + 1 + action;
+            return m_flopDepth == 0 ? SUBTREE_SIZES[child] : FLOP_SUBTREE_SIZES[child];
+        }
+
+    private:
+        int m_depth = 0, m_flopDepth = 0, m_line = 0;
+        std::array<int, MAX_DEPTH+1> m_positions {0};
+
+        const Terminal &terminal() const {
+            int pos = m_positions[m_depth];
+            return m_flopDepth == 0 ? PREFLOP_TERMINALS[pos] : FLOP_TERMINALS[m_line][pos];
+        }
+    };
+
+    typedef CommunityFlopVectorCFR Vector;
+
+    static std::string infoSetName(int index) {
+        int hand = index % NUM_HANDS;
+        std::string card = std::to_string(hand + 1);
+        if (index < PREFLOP_INFOSETS)
+            return card + HISTORIES[index / NUM_HANDS];
+        index = (index - PREFLOP_INFOSETS) / NUM_HANDS;
+        int history = index % NUM_HISTORIES, flop = index / NUM_HISTORIES % NUM_VALUES;
+        int line = index / NUM_HISTORIES / NUM_VALUES;
+        return card + LINES[line] + "/" + std::to_string(flop + 1) + HISTORIES[history];
+    }
+};
+
+// Full-width CFR over both rounds, as in VectorCFR.h, with the flop's
+// chance node enumerated: its value is the sum over flops, each flop's
+// terminals carrying that flop's share of the deal probability.
+class CommunityFlopVectorCFR {
+    typedef KuhnPokerCommunityFlopGame Game;
+    static const int NUM_ACTIONS = Game::NUM_ACTIONS, NUM_HANDS = Game::NUM_HANDS, NUM_VALUES = Game::NUM_VALUES;
+    static const int PREFLOP = -1; // line of the first round
+    typedef std::array<double, NUM_HANDS> HandVector;
+
+public:
+    CommunityFlopVectorCFR() {
+        for (int f=0; f<NUM_VALUES; f++) {
+            for (int h=0; h<NUM_HANDS; h++) {
+                for (int o=0; o<NUM_HANDS; o++) {
+                    m_chance[f][h][o] = Game::CHANCE[f][h][o];
+                    m_showdown[f][h][o] = Game::CHANCE[f][h][o] * Game::SHOWDOWN[f][h][o];
+                    m_preflopChance[h][o] += Game::CHANCE[f][h][o];
+                }
+            }
+        }
+    }
+
+    // Iteration t of CFR under the regret-update Policy, returning the
+    // expected value of the current strategies for the first player
+    template <typename Policy, typename NodeTable>
+    double iterate(NodeTable &nodes, long t) const {
+        Weights weights {Policy::regretWeight(t), Policy::strategyWeight(t)};
+        HandVector reach[2], values[2];
+        reach[0].fill(1.0);
+        reach[1].fill(1.0);
+        walk(nodes, PREFLOP, 0, 0, 0, reach, values, Policy::ALTERNATING ? 0 : BOTH_PLAYERS, weights);
+        double value = 0.0;
+        for (double v : values[0])
+            value += v;
+        if (Policy::ALTERNATING)
+            walk(nodes, PREFLOP, 0, 0, 0, reach, values, 1, weights);
+        if (Policy::TABLE_PASS)
+            for (auto &node : nodes)
+                Policy::endIteration(node, t);
+        return value;
+    }
+
+    // Exploitability of the average strategy in chips per game: the mean of
+    // what each player wins by best responding to the other
+    template <typename NodeTable>
+    double exploitability(const NodeTable &nodes) const {
+        double total = 0.0;
+        for (int player=0; player<2; player++) {
+            HandVector oppReach, values;
+            oppReach.fill(1.0);
+            bestResponse(nodes, PREFLOP, 0, 0, 0, player, oppReach, values);
+            for (double value : values)
+                total += value;
+        }
+        return total / 2;
+    }
+
+private:
+    // Matrices of the public states, built once: the chance-weighted
+    // showdown results of each flop and the chance of each pair of hands on
+    // each flop and over all flops, for folds before it. A terminal of the
+    // vector walk is then one small matrix-vector product.
+    typedef std::array<HandVector, NUM_HANDS> Matrix;
+    std::array<Matrix, NUM_VALUES> m_showdown, m_chance;
+    Matrix m_preflopChance {};
+
+    static const int BOTH_PLAYERS = -1;
+    struct Weights {
+        double regret, strategy;
+    };
+
+    static const Terminal &terminal(int line, int pos) {
+        return line == PREFLOP ? Game::PREFLOP_TERMINALS[pos] : Game::FLOP_TERMINALS[line][pos];
+    }
+
+    // index of the first hand's node of history `pos` of round `line`
+    static int rowIndex(int line, int flop, int pos) {
+        return line == PREFLOP ? Game::HISTORY_IDS[pos]*NUM_HANDS
+                               : Game::flopInfoset(line, flop, Game::HISTORY_IDS[pos], 0);
+    }
+
+    // y = scale * M x
+    static void matVec(const Matrix &m, const HandVector &x, double scale, HandVector &y) {
+        for (int h=0; h<NUM_HANDS; h++) {
+            double sum = 0.0;
+            for (int o=0; o<NUM_HANDS; o++)
+                sum += m[h][o] * x[o];
+            y[h] = scale * sum;
+        }
+    }
+
+    // Walks the public tree below trie position `pos` of round `line` on
+    // `flop`, `depth` actions into the round. Only `updater`'s nodes are
+    // updated, or every node for BOTH_PLAYERS.
+    template <typename NodeTable>
+    void walk(NodeTable &nodes, int line, int flop, int pos, int depth, const HandVector reach[2], HandVector values[2],
+              int updater, const Weights &weights) const {
+        int player = depth % 2, opponent = 1 - player;
+        const Terminal &t = terminal(line, pos);
+        if (t.terminal) {
+            if (line == PREFLOP && t.showdownStake) {
+                HandVector flopValues[2];
+                values[0].fill(0.0);
+                values[1].fill(0.0);
+                for (int f=0; f<NUM_VALUES; f++) {
+                    walk(nodes, Game::LINE_IDS[pos], f, 0, 0, reach, flopValues, updater, weights);
+                    for (int p=0; p<2; p++)
+                        for (int h=0; h<NUM_HANDS; h++)
+                            values[p][h] += flopValues[p][h];
+                }
+            } else if (t.showdownStake) {
+                matVec(m_showdown[flop], reach[1], t.showdownStake, values[0]);
+                matVec(m_showdown[flop], reach[0], t.showdownStake, values[1]);
+            } else {
+                // the player to act after a fold is the one who did not fold
+                const Matrix &chance = line == PREFLOP ? m_preflopChance : m_chance[flop];
+                matVec(chance, reach[opponent], t.foldPayoff, values[player]);
+                matVec(chance, reach[player], -t.foldPayoff, values[opponent]);
+            }
+            return;
+        }
+
+        bool update = updater == BOTH_PLAYERS || updater == player;
+        auto *row = &nodes[rowIndex(line, flop, pos)];
+        std::array<std::array<double, NUM_ACTIONS>, NUM_HANDS> strategy;
+        for (int h=0; h<NUM_HANDS; h++) {
+            strategy[h] = row[h].getStrategy();
+            if (update)
+                for (int a=0; a<NUM_ACTIONS; a++)
+                    row[h].strategySum[a] += weights.strategy * reach[player][h] * strategy[h][a];
+        }
+
+        HandVector childReach[2], childValues[NUM_ACTIONS][2];
+        values[0].fill(0.0);
+        values[1].fill(0.0);
+        childReach[opponent] = reach[opponent];
+        for (int a=0; a<NUM_ACTIONS; a++) {
+            for (int h=0; h<NUM_HANDS; h++)
+                childReach[player][h] = reach[player][h] * strategy[h][a];
+            walk(nodes, line, flop, NUM_ACTIONS*pos + 1 + a, depth + 1, childReach, childValues[a], updater,
+                 weights);
+            for (int h=0; h<NUM_HANDS; h++) {
+                values[player][h] += strategy[h][a] * childValues[a][player][h];
+                values[opponent][h] += childValues[a][opponent][h];
+            }
+        }
+
+        // counterfactual values already carry the opponent's reach
+        if (update)
+            for (int h=0; h<NUM_HANDS; h++)
+                for (int a=0; a<NUM_ACTIONS; a++)
+                    row[h].regretSum[a] += weights.regret * (childValues[a][player][h] - values[player][h]);
+    }
+
+    // values[h] is the responder's best-response counterfactual value of
+    // holding hand h against the opponent's average strategy
+    template <typename NodeTable>
+    void bestResponse(const NodeTable &nodes, int line, int flop, int pos, int depth, int responder,
+                      const HandVector &oppReach, HandVector &values) const {
+        const Terminal &t = terminal(line, pos);
+        if (t.terminal) {
+            if (line == PREFLOP && t.showdownStake) {
+                HandVector flopValues;
+                values.fill(0.0);
+                for (int f=0; f<NUM_VALUES; f++) {
+                    bestResponse(nodes, Game::LINE_IDS[pos], f, 0, 0, responder, oppReach, flopValues);
+                    for (int h=0; h<NUM_HANDS; h++)
+                        values[h] += flopValues[h];
+                }
+            } else if (t.showdownStake) {
+                matVec(m_showdown[flop], oppReach, t.showdownStake, values);
+            } else {
+                const Matrix &chance = line == PREFLOP ? m_preflopChance : m_chance[flop];
+                matVec(chance, oppReach, depth % 2 == responder ? t.foldPayoff : -t.foldPayoff, values);
+            }
+            return;
+        }
+
+        HandVector childReach, childValues;
+        if (depth % 2 == responder) {
+            for (int a=0; a<NUM_ACTIONS; a++) {
+                bestResponse(nodes, line, flop, NUM_ACTIONS*pos + 1 + a, depth + 1, responder, oppReach,
+                             childValues);
+                for (int h=0; h<NUM_HANDS; h++)
+                    values[h] = a == 0 ? childValues[h] : std::max(values[h], childValues[h]);
+            }
+            return;
+        }
+
+        const auto *row = &nodes[rowIndex(line, flop, pos)];
+        std::array<std::array<double, NUM_ACTIONS>, NUM_HANDS> strategy;
+        for (int h=0; h<NUM_HANDS; h++)
+            strategy[h] = row[h].getAverageStrategy();
+        values.fill(0.0);
+        for (int a=0; a<NUM_ACTIONS; a++) {
+            for (int h=0; h<NUM_HANDS; h++)
+                childReach[h] = oppReach[h] * strategy[h][a];
+            bestResponse(nodes, line, flop, NUM_ACTIONS*pos + 1 + a, depth + 1, responder, childReach,
+                             childValues);
+            for (int h=0; h<NUM_HANDS; h++)
+                values[h] += childValues[h];
+        }
+    }
+};
+
+int main(int argc, char **argv) {
+    Options options(argc, argv);
+    try {
+        runPokerTrainer<KuhnPokerCommunityFlopGame>(options);
+    } catch (const std::exception &e) {
+        std::cerr << "error: " << e.what() << "\n";
+        return 1;
+    }
+
+    return 0;
+}
@@ -1,215 +1,187 @@
 #include <iostream>
-#include <random>
 #include <array>
 #include <string>
-#include <map>
 #include <algorithm>
-#include <time.h>
-
-class KuhnPokerTwoCardsCFR {
+#include "HandRanking.h"
+#include "Options.h"
+#include "PokerCFR.h"
+#include "PublicTree.h"
+#include "VectorCFR.h"
+#include "Checkpoint.h"
+#include "MonteCarloCFR.h"
+#include "HandIsomorphism.h"
+#include "Rng.h"
+
+// Two-card hands are sorted pairs of card values 1-4 (card1 <= card2),
+// numbered 11, 12, 22, 13, 23, 33, 14, ...
+constexpr int handIndex(int card1, int card2) {
+    return (card2-1)*card2/2 + card1-1;
+}
+
+constexpr int handHighCard(int hand) {
+    int card2 = 1;
+    while (handIndex(1, card2+1) <= hand)
+        card2++;
+    return card2;
+}
+
+constexpr int handLowCard(int hand) {
+    return hand - handIndex(1, handHighCard(hand)) + 1;
+}
+
+// pairs beat unpaired hands, which are compared by their high card and then
+// their low card
+constexpr int handStrength(int hand) {
+    int high = handHighCard(hand), low = handLowCard(hand);
+    return low == high ? 100 + high : 10*high + low;
+}
+
+// Two-card Kuhn poker, trained by the PokerCFR engine. Each player is dealt
+// two cards from four copies each of the values 1-4. Actions are bet levels
+// (p < b < B) with stakes 1, 2 and 4.
+struct KuhnPokerTwoCardsGame {
     static const int NUM_ACTIONS = 3, NUM_CARDS = 4*4;
     static const int PASS = 0, SMALL_BET = 1, BIG_BET = 2;
+    static const int NUM_HANDS = 10; // sorted pairs of card values 1-4
+
+    // Non-terminal betting histories. Each (hand, history) pair is one
+    // information set, stored at index historyId*NUM_HANDS + handIndex of the
+    // node table. While walking the tree the history is tracked as its
+    // position in the betting trie so that the node index never has to be
+    // built from a string.
+    static const int NUM_HISTORIES = 8, MAX_POSITION = 19;
+    static const int NUM_POSITIONS = NUM_ACTIONS*MAX_POSITION + 1;
+    static constexpr std::array<const char *, NUM_HISTORIES> HISTORIES {
+        "", "p", "b", "B", "pb", "pB", "bB", "pbB"
+    };
+    static const int NUM_INFOSETS = NUM_HISTORIES * NUM_HANDS;
+
+    static constexpr auto HISTORY_IDS = makeHistoryIds<NUM_ACTIONS, MAX_POSITION>(HISTORIES, "pbB");
+    static constexpr auto TERMINALS = makeBetLevelTerminals<NUM_ACTIONS, NUM_POSITIONS>({1, 2, 4});
+    static constexpr auto SUBTREE_SIZES = makeSubtreeSizes<NUM_ACTIONS, NUM_POSITIONS>(TERMINALS);
+    static constexpr int MAX_REGRET_STEP = 2*maxPayoff(TERMINALS);
+    static constexpr auto SHOWDOWN = makeShowdownTable<NUM_HANDS>(handStrength);
+
+    // probability of dealing hand h0 to player 1 and h1 to player 2
+    static constexpr auto CHANCE = [] {
+        std::array<std::array<double, NUM_HANDS>, NUM_HANDS> chance {};
+        const int copies = NUM_CARDS / 4;
+        const double deals = NUM_CARDS * (NUM_CARDS-1) * (NUM_CARDS-2) * (NUM_CARDS-3);
+        for (int v0=1; v0<=4; v0++)
+            for (int v1=1; v1<=4; v1++)
+                for (int v2=1; v2<=4; v2++)
+                    for (int v3=1; v3<=4; v3++) {
+                        // ways to draw these values in order from the deck
+                        int ways = copies * (copies - (v1==v0))
+                                 * (copies - (v2==v0) - (v2==v1))
+                                 * (copies - (v3==v0) - (v3==v1) - (v3==v2));
+                        int h0 = handIndex(v0 < v1 ? v0 : v1, v0 < v1 ? v1 : v0);
+                        int h1 = handIndex(v2 < v3 ? v2 : v3, v2 < v3 ? v3 : v2);
+                        chance[h0][h1] += ways / deals;
+                    }
+        return chance;
+    }();
+
+    static const GameId ID = GameId::KuhnPokerTwoCards;
+    static const uint64_t SEED = 9;
+    static const long ITERATIONS = 100000000;
+    static const int SAMPLED_NODES = NUM_HISTORIES;
+
+    struct Deal {
+        std::array<int, 2> hands {0};
+    };
 
-private:
-    class Node {
+    // The cards, four of which are shuffled to the front for each deal
+    class Deck {
     public:
-        std::string infoSet;
-        std::array<double, NUM_ACTIONS> regretSum {0.0};
-        std::array<double, NUM_ACTIONS> strategy {0.0};
-        std::array<double, NUM_ACTIONS> strategySum {0.0};
-
-        std::array<double, NUM_ACTIONS> getAverageStrategy() {
-            std::array<double, NUM_ACTIONS> avgStrategy;
-            double normalisingSum;
-            for (int a=0; a<NUM_ACTIONS; a++)
-                normalisingSum += strategySum[a];
-            for (int a=0; a<NUM_ACTIONS; a++) {
-                if (normalisingSum > 0)
-                    avgStrategy[a] = strategySum[a] / normalisingSum;
-                else
-                    avgStrategy[a] = 1.0 / NUM_ACTIONS;
-            }
-            return avgStrategy;
+        void deal(Rng &rng, Deal &deal) {
+            partialShuffle(m_cards.data(), NUM_CARDS, 4, rng);
+            deal.hands[0] = handIndex(std::min(m_cards[0], m_cards[1]), std::max(m_cards[0], m_cards[1]));
+            deal.hands[1] = handIndex(std::min(m_cards[2], m_cards[3]), std::max(m_cards[2], m_cards[3]));
         }
 
-        std::array<double, NUM_ACTIONS> getStrategy(double realisationWeight) {
-            double normalisingSum = 0.0;
-            for (int a=0; a<NUM_ACTIONS; a++) {
-                strategy[a] = regretSum[a] > 0 ? regretSum[a] : 0;
-                normalisingSum += strategy[a];
-            }
-            for (int a=0; a<NUM_ACTIONS; a++) {
-                if (normalisingSum > 0)
-                    strategy[a] /= normalisingSum;
-                else
-                    strategy[a] = 1.0 / NUM_ACTIONS;
-                strategySum[a] += realisationWeight * strategy[a];
-            }
-            return strategy;
-        }
-
-        std::string toString() {
-            std::array<double, NUM_ACTIONS> avgStrategy = getAverageStrategy();
-            std::string res = infoSet + ": [" + std::to_string(avgStrategy[0]) + ", " + std::to_string(avgStrategy[1]) + ", " + std::to_string(avgStrategy[2]) + "]";
-            return res;
-        }
+    private:
+        std::array<int, NUM_CARDS> m_cards {1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4};
     };
 
-    std::map<std::string, Node *> m_nodeMap;
-
-public:
-    void train(int iterations) {
-        std::array<int, NUM_CARDS> cards {1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4};
-        double util = 0.0;
-        int n_doubles = 0;
-        for (int i=0; i<iterations; i++) {
-            if (i % 1000000 == 0) 
-            std::cout << "Training " << 100.0*i/(double)iterations << "\% done\n";
-            // shuffle cards
-            std::random_shuffle(cards.begin(), cards.end());
-            if (cards[0] == cards[1])
-                n_doubles++;
-            util += cfr(cards, "", 1.0, 1.0);
-        }
-        std::cout << "Chance for pair: " << 100.0*n_doubles/(double)iterations << "\%\n";
-        std::cout << "Average game value: " << util/iterations << "\nFinal Strategy:\n";
-        for (auto &n : m_nodeMap) {
-            std::cout << "\t" << n.second->toString() << "\n";
-        }
-    }
-
-private:
-    double cfr(std::array<int, NUM_CARDS> cards, std::string history, double p0, double p1) {
-        // std::cout << "CFR(" << history << ")\n";
-        
-        int turnIndex = history.length();
-        int player = turnIndex % 2;
-        int opponent = 1-player;
-        int playerCard1 = cards[2*player];
-        int playerCard2 = cards[2*player+1];
-        if (playerCard1 > playerCard2) { // ensure sorted
-            int temp = playerCard1;
-            playerCard1 = playerCard2;
-            playerCard2 = temp;
-        }
-        int opponentCard1 = cards[2*opponent];
-        int opponentCard2 = cards[2*opponent+1];
-        if (opponentCard1 > opponentCard2) { // ensure sorted
-            int temp = opponentCard1;
-            opponentCard1 = opponentCard2;
-            opponentCard2 = temp;
-        }
-
-        // Return payoff for terminal states
-        if (turnIndex >= 2) {
-            std::string lastTwo = history.substr(turnIndex - 2);
-            // get winning card data, 0 if opponent wins, 1 if player wins, -1 if draw
-            int winningCardsData = arePlayerCardsHigher(playerCard1, playerCard2, opponentCard1, opponentCard2);
-            // winning score: 0 if draw, 1 if player wins, -1 if opponent wins
-            int winningScore = winningCardsData == -1 ? 0 : winningCardsData*2 - 1;
-            if (lastTwo == "pp")
-                return winningScore;
-            else if (lastTwo == "bb")
-                return winningScore * 2.0;
-            else if (lastTwo == "BB")
-                return winningScore * 4.0;
-            else if (lastTwo == "bp")
-                return 1.0;
-            else if (lastTwo == "Bp" || lastTwo == "Bb") {
-                // we now must determine if the player who folds after the B
-                // had previously bet small before.
-                if (turnIndex == 2) // they can't have done so
-                    return 1.0;
-                if (turnIndex == 4) // they must have done so (pbBp)
-                    return 2.0;
-                if (history.substr(turnIndex - 3, 1) == "p") // they passed previously
-                    return 1.0;
-                else
-                    return 2.0;
-            }
-        }
-
-        // Create info set
-        std::string infoSet = std::to_string(playerCard1) + std::to_string(playerCard2) + history;
-
-        // get node or create it if nonexistant
-        Node *node;
-        if (m_nodeMap.find(infoSet) == m_nodeMap.end()) {
-            // node doesn't exist yet
-            node = new Node();
-            node->infoSet = infoSet;
-            m_nodeMap[infoSet] = node;
-            // std::cout << "Creating Node(" << infoSet << ")";
-        } else
-            node = m_nodeMap[infoSet];
-
-        // for each action recursively call cfr
-        // with additional history and probability
-        std::array<double, NUM_ACTIONS> strategy = node->getStrategy(player == 0 ? p0 : p1);
-        std::array<double, NUM_ACTIONS> util {0.0};
-        double nodeUtil = 0.0;
-        for (int a=0; a<NUM_ACTIONS; a++) {
-            std::string nextHistory = history + "";
-            switch (a) {
-                case PASS: nextHistory += "p"; break;
-                case SMALL_BET: nextHistory += "b"; break;
-                case BIG_BET: nextHistory += "B"; break;
-            }
-            if (player == 0)
-                util[a] = -cfr(cards, nextHistory, p0*strategy[a], p1);
-            else
-                util[a] = -cfr(cards, nextHistory, p0, p1*strategy[a]);
-            // std::cout << "(" << history << ") calling CFR(" << nextHistory << "), got " << util[a] << "\n";
-            nodeUtil += strategy[a] * util[a];
-        }
+    typedef BetLevelHistory<KuhnPokerTwoCardsGame, 4> History;
+    typedef VectorCFR<KuhnPokerTwoCardsGame> Vector;
 
-        // for each action, compute and accumulate cfr
-        for (int a=0; a<NUM_ACTIONS; a++) {
-            double regret = util[a] - nodeUtil;
-            node->regretSum[a] += (player == 0 ? p1 : p0) * regret;
-            // std::cout << "Node(" << infoSet << ") regret[" << a << "], adding " << (player == 0 ? p1 : p0) * regret << ", -> " << m_nodeMap[infoSet]->regretSum[a] << "\n";
-        }
-
-        return nodeUtil;
+    static std::string infoSetName(int index) {
+        int hand = index % NUM_HANDS;
+        return std::to_string(handLowCard(hand)) + std::to_string(handHighCard(hand)) + HISTORIES[index / NUM_HANDS];
     }
+};
 
-    int arePlayerCardsHigher(int playerCard1, int playerCard2, int opponentCard1, int opponentCard2) {
-        bool playerHasPair = playerCard1 == playerCard2;
-        bool opponentHasPair = opponentCard1 == opponentCard2;
-        if (playerHasPair) {
-            if (opponentHasPair) {
-                if (playerCard1 == opponentCard1)
-                    return -1;
-                return playerCard1 > opponentCard1;
-            }
-            return 1;
+int main(int argc, char **argv) {
+    Options options(argc, argv);
+    try {
+        long iterations = options.getInt("iterations", KuhnPokerTwoCardsGame::ITERATIONS);
+
+        if (options.has("check-isomorphism")) {
+            reportHandIndexerChecks();
+            // the fixed game's closed-form hand numbering is the indexer's
+            HandIndexer indexer(4, 4, {2}, false);
+            for (int c0=0; c0<KuhnPokerTwoCardsGame::NUM_CARDS; c0++)
+                for (int c1=0; c1<KuhnPokerTwoCardsGame::NUM_CARDS; c1++) {
+                    int cards[2] = {c0, c1}, v0 = c0/4 + 1, v1 = c1/4 + 1;
+                    if (c0 != c1 && indexer.index(cards) != handIndex(std::min(v0, v1), std::max(v0, v1)))
+                        throw std::runtime_error("hand indexer disagrees with handIndex()");
+                }
+            std::cout << "All hand indexers are bijections onto their classes\n";
+            return 0;
         }
-        if (opponentHasPair)
+        if (options.has("deck-benchmark")) {
+            reportDeckScaling(options.getInt("max-values", 12), options.getInt("copies", 4),
+                              options.getInt("max-raises", 5), options.getDouble("seconds", 1.0));
             return 0;
-
-        int playerBestCard = std::max(playerCard1, playerCard2);
-        int opponentBestCard = std::max(opponentCard1, opponentCard2);
-        if (playerBestCard > opponentBestCard)
-            return 1;
-        if (opponentBestCard > playerBestCard)
+        }
+        // the game of --values, --copies and --stakes (or --raises doubling
+        // bets), each option prefixed with `prefix` if given that way
+        auto variant = [&](const std::string &prefix) {
+            auto get = [&](const std::string &name, long defaultValue) {
+                return options.getInt(prefix + name, options.getInt(name, defaultValue));
+            };
+            std::string stakes = options.getString(prefix + "stakes", options.getString("stakes", ""));
+            if (!stakes.empty() && !options.has(prefix + "raises"))
+                return TwoCardKuhnVariant(get("values", 4), get("copies", 4), parseStakes(stakes));
+            return TwoCardKuhnVariant(get("values", 4), get("copies", 4), (int)get("raises", 2));
+        };
+        if (options.has("compare-warm-start")) {
+            reportWarmStart(variant(""), parseSampling(options.getString("sampling", "full")),
+                            options.getDouble("target-exploitability", 0.1),
+                            options.getInt("max-iterations", 10000000), options.getInt("warm-weight", 10),
+                            options.getInt("seed", MonteCarloTwoCardsCFR::SEED));
             return 0;
-
-        int playerSecondBestCard = std::min(playerCard1, playerCard2);
-        int opponentSecondBestCard = std::min(opponentCard1, opponentCard2);
-        if (playerSecondBestCard > opponentSecondBestCard)
-            return 1;
-        if (opponentSecondBestCard > playerSecondBestCard)
+        }
+        // a runtime deck or betting, a warm start or a sampling scheme other
+        // than the fixed game's chance sampling trains the Monte Carlo trainer
+        if (options.has("sampling") || options.has("values") || options.has("copies") || options.has("raises")
+            || options.has("stakes") || options.has("warm-start")) {
+            TwoCardKuhnVariant game = variant("");
+            MonteCarloTwoCardsCFR trainer(game, parseSampling(options.getString("sampling", "chance")));
+            if (options.has("seed"))
+                trainer.setSeed(options.getInt("seed", 0));
+            if (options.has("warm-start")) {
+                // the game the checkpoint solved, as it records it, or as
+                // the --warm-* options say, which it is checked against
+                std::string path = options.getString("warm-start", "");
+                bool given = options.has("warm-values") || options.has("warm-copies") || options.has("warm-stakes")
+                          || options.has("warm-raises");
+                TwoCardKuhnVariant previous = given ? variant("warm-") : TwoCardKuhnVariant::fromCheckpoint(path);
+                int seeded = trainer.warmStart(previous, path, options.getInt("warm-weight", 10));
+                std::cout << "Warm start: " << seeded << " of " << game.numInfosets() << " infosets seeded\n";
+            }
+            trainer.train(iterations);
+            if (options.has("checkpoint"))
+                trainer.saveCheckpoint(options.getString("checkpoint", ""));
             return 0;
-        // it's a tie!
-        return -1;
+        }
+        runPokerTrainer<KuhnPokerTwoCardsGame>(options);
+    } catch (const std::exception &e) {
+        std::cerr << "error: " << e.what() << "\n";
+        return 1;
     }
-};
-
-int main() {
-    srand(9);
-    
-    KuhnPokerTwoCardsCFR trainer = KuhnPokerTwoCardsCFR();
-    trainer.train(100000000);
 
     return 0;
-}
\ No newline at end of file
+}
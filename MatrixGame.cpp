@@ -0,0 +1,90 @@
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include "Options.h"
+#include "NormalFormGame.h"
+
+// Regret matching on a two-player zero-sum game whose payoff matrix is read
+// from a file, mapped rather than loaded so that it can be larger than
+// memory. --write-random writes a random matrix to train on.
+
+// Prints the `count` actions of a player that its strategy plays most often
+void printTopActions(const char *player, const std::vector<double> &strategy, int count) {
+    std::vector<int> actions(strategy.size());
+    for (size_t a=0; a<actions.size(); a++)
+        actions[a] = a;
+    count = std::min<int>(count, actions.size());
+    std::partial_sort(actions.begin(), actions.begin() + count, actions.end(),
+                      [&](int a, int b) { return strategy[a] > strategy[b]; });
+    int support = std::count_if(strategy.begin(), strategy.end(), [](double p) { return p > 1e-3; });
+    std::cout << player << " plays " << support << " of " << strategy.size()
+              << " actions more than 0.1% of the time:\n";
+    for (int i=0; i<count; i++)
+        std::cout << "\t" << actions[i] << " : " << strategy[actions[i]] << "\n";
+}
+
+int main(int argc, char **argv) {
+    Options options(argc, argv);
+    try {
+        if (options.has("write-random")) {
+            std::string path = options.getString("write-random", "");
+            long rows = options.getInt("rows", 1000), cols = options.getInt("cols", rows);
+            Rng rng(options.getInt("seed", 1));
+            withPayoffType(parsePayoffType(options.getString("payoff-type", "float")), [&](auto payoff) {
+                typedef decltype(payoff) Payoff;
+                writeMatrix<Payoff>(path, rows, cols, [&](uint64_t, Payoff *row) {
+                    for (long b=0; b<cols; b++) {
+                        int payoff = (int)rng.below(201) - 100;
+                        row[b] = std::is_integral<Payoff>::value ? payoff : payoff / 100.0;
+                    }
+                });
+            });
+            return 0;
+        }
+
+        if (!options.has("matrix"))
+            throw std::runtime_error("--matrix path (or --write-random path) is required");
+        std::string path = options.getString("matrix", "");
+        long iterations = options.getInt("iterations", 1000);
+        int threads = options.getInt("threads", 0);
+        long syncInterval = options.getInt("sync-interval", 10000);
+
+        withPayoffType(readMatrixHeader(path).type, [&](auto payoff) {
+            typedef NormalFormCFR<decltype(payoff)> Trainer;
+            if (options.has("compare-modes")) {
+                reportFullWidthComparison([&] { return Trainer(PayoffMatrix<decltype(payoff)>::map(path),
+                                                               GameId::MatrixGame); },
+                                          options.getDouble("target-exploitability", 0.001),
+                                          options.getInt("max-iterations", 100000));
+                return;
+            }
+
+            Trainer trainer(PayoffMatrix<decltype(payoff)>::map(path), GameId::MatrixGame);
+            if (options.has("seed"))
+                trainer.setSeed(options.getInt("seed", 0));
+            std::cout << "Matrix of " << trainer.numActions(0) << " x " << trainer.numActions(1) << " payoffs\n";
+            if (options.has("full-width"))
+                trainer.setFullWidthMode(options.has("alternating"));
+            else if (threads > 0)
+                trainer.setThreads(threads, syncInterval);
+            if (options.has("resume"))
+                trainer.loadCheckpoint(options.getString("resume", ""));
+            if (options.has("checkpoint"))
+                trainer.setCheckpoint(options.getString("checkpoint", ""), options.getInt("checkpoint-interval", 1000));
+            if (options.has("eval-interval"))
+                trainer.setEvaluation(options.getInt("eval-interval", 0),
+                                      options.getDouble("target-exploitability", 0.0),
+                                      options.getString("eval-log", ""));
+            trainer.train(iterations);
+            int top = options.getInt("top", 10);
+            printTopActions("First player", trainer.getAverageStrategy(0), top);
+            printTopActions("Second player", trainer.getAverageStrategy(1), top);
+            std::cout << "Exploitability: " << trainer.exploitability() << " per game\n";
+        });
+    } catch (const std::exception &e) {
+        std::cerr << "error: " << e.what() << "\n";
+        return 1;
+    }
+
+    return 0;
+}
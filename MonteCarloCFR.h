@@ -0,0 +1,748 @@
+#pragma once
+#include <array>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <algorithm>
+#include <stdexcept>
+#include "NodeStorage.h"
+#include "HandIsomorphism.h"
+#include "Checkpoint.h"
+#include "Rng.h"
+
+// Two-card Kuhn poker with its deck and betting set at run time: `values`
+// card values with `copies` of each, and bet levels 0..raises with the
+// given stakes, 1, 2, 4, ... by default, under the bet-level rule of
+// PublicTree.h. With 4 values, 4 copies and stakes 1, 2 and 4 it is the
+// game of KuhnPokerTwoCards.cpp.
+//
+// Cards are numbered (value-1)*copies + copy and hands are the classes of
+// HandIndexer, which ignores the copy and the order of the two cards. The
+// class of every pair of cards is tabulated, so a deal is canonicalised
+// with one load per hand and node visits index by hand directly.
+//
+// After the first action a non-terminal history only ever raises, so it is
+// a strictly increasing sequence of levels and is identified by the bit set
+// of the levels in it. Nodes are stored densely at historyMask*numHands +
+// hand, with no trie table to build.
+class TwoCardKuhnVariant {
+public:
+    static const int MAX_ACTIONS = 8;
+
+    // The public state of a betting history. child() gives the history
+    // after one more action; terminal histories carry their payoff for the
+    // player to act, foldPayoff + showdownStake * showdown(own, opponent).
+    struct Betting {
+        int mask = 0, level = 0, depth = 0;
+        std::array<int, 2> committed {0, 0};
+        bool terminal = false;
+        int foldPayoff = 0, showdownStake = 0;
+
+        int player() const {
+            return depth % 2;
+        }
+    };
+
+    TwoCardKuhnVariant(int values, int copies, int raises)
+        : TwoCardKuhnVariant(values, copies, doublingStakes(raises)) {}
+
+    // stakes[a] is the total a player has put in after betting at level a,
+    // stakes[0] being the ante
+    TwoCardKuhnVariant(int values, int copies, const std::vector<int> &stakes)
+        : m_values(values), m_copies(copies), m_numActions(stakes.size()), m_stakes(stakes),
+          m_indexer(checkDeck(values, copies), copies, {2}, false) {
+        if (m_numActions < 2 || m_numActions > MAX_ACTIONS)
+            throw std::runtime_error("raises must be between 1 and " + std::to_string(MAX_ACTIONS - 1));
+        for (int a=0; a<m_numActions; a++)
+            if (stakes[a] < 1 || stakes[a] > UINT16_MAX || (a > 0 && stakes[a] <= stakes[a-1]))
+                throw std::runtime_error("stakes must rise from an ante of at least 1 to at most "
+                                         + std::to_string(UINT16_MAX));
+        m_numHands = m_indexer.size();
+        int numCards = deckSize();
+        m_pairHands.resize(numCards * numCards);
+        for (int c0=0; c0<numCards; c0++) {
+            for (int c1=0; c1<numCards; c1++) {
+                int cards[2] = {c0, c1};
+                m_pairHands[c0*numCards + c1] = c0 == c1 ? -1 : m_indexer.index(cards);
+            }
+        }
+
+        m_showdown.resize(m_numHands * m_numHands);
+        for (int h0=0; h0<m_numHands; h0++)
+            for (int h1=0; h1<m_numHands; h1++)
+                m_showdown[h0*m_numHands + h1] = (strength(h0) > strength(h1)) - (strength(h0) < strength(h1));
+
+        // count the ordered four-card draws giving each pair of hands
+        m_chance.resize(m_numHands * m_numHands);
+        double deals = 1.0;
+        for (int i=0; i<4; i++)
+            deals *= numCards - i;
+        for (int c0=0; c0<numCards; c0++)
+            for (int c1=0; c1<numCards; c1++)
+                for (int c2=0; c2<numCards; c2++)
+                    for (int c3=0; c3<numCards; c3++) {
+                        int h0 = m_pairHands[c0*numCards + c1], h1 = m_pairHands[c2*numCards + c3];
+                        if (h0 >= 0 && h1 >= 0 && c2 != c0 && c2 != c1 && c3 != c0 && c3 != c1)
+                            m_chance[h0*m_numHands + h1] += 1.0 / deals;
+                    }
+    }
+
+    int numActions() const { return m_numActions; }
+    int numHands() const { return m_numHands; }
+    int numHistories() const { return 1 << m_numActions; }
+    int numInfosets() const { return numHistories() * m_numHands; }
+    int deckSize() const { return m_values * m_copies; }
+    int values() const { return m_values; }
+    int copies() const { return m_copies; }
+    const std::vector<int> &stakes() const { return m_stakes; }
+
+    // the empty history, both players having anted
+    Betting root() const {
+        Betting b;
+        b.committed = {m_stakes[0], m_stakes[0]};
+        return b;
+    }
+
+    // card values of a hand, the lower first
+    int lowValue(int hand) const {
+        return m_indexer.representative(hand)[0] / m_copies + 1;
+    }
+
+    int highValue(int hand) const {
+        return m_indexer.representative(hand)[1] / m_copies + 1;
+    }
+
+    // the hand of two cards of the given values, or -1 if this deck cannot
+    // deal it
+    int handOfValues(int low, int high) const {
+        if (low < 1 || high > m_values || low > high || (low == high && m_copies < 2))
+            return -1;
+        return hand((low-1)*m_copies, (high-1)*m_copies + (low == high));
+    }
+
+    // the rules as a checkpoint records them: values, copies, then stakes
+    CheckpointParameters parameters() const {
+        CheckpointParameters parameters {};
+        parameters[0] = m_values;
+        parameters[1] = m_copies;
+        for (int a=0; a<m_numActions; a++)
+            parameters[2 + a] = m_stakes[a];
+        return parameters;
+    }
+
+    // the game a checkpoint of MonteCarloTwoCardsCFR solved
+    static TwoCardKuhnVariant fromCheckpoint(const std::string &path) {
+        CheckpointHeader header = readCheckpointHeader(path);
+        if (header.game != GameId::KuhnPokerTwoCardsVariant)
+            throw std::runtime_error("checkpoint is for another game: " + path);
+        if (header.parameters[0] == 0 || header.numActions < 2 || header.numActions > MAX_ACTIONS)
+            throw std::runtime_error("checkpoint does not record its rules: " + path);
+        std::vector<int> stakes(header.parameters.begin() + 2, header.parameters.begin() + 2 + header.numActions);
+        return TwoCardKuhnVariant(header.parameters[0], header.parameters[1], stakes);
+    }
+
+    // e.g. "4 values x 4 copies, stakes 1/2/4"
+    std::string rulesName() const {
+        return std::to_string(m_values) + " values x " + std::to_string(m_copies) + " copies, stakes " + stakesName();
+    }
+
+    // the stakes written as e.g. "1/2/4"
+    std::string stakesName() const {
+        std::string name;
+        for (int a=0; a<m_numActions; a++)
+            name += (a ? "/" : "") + std::to_string(m_stakes[a]);
+        return name;
+    }
+
+    // the hand holding two different cards, in either order
+    int hand(int card1, int card2) const {
+        return m_pairHands[card1*deckSize() + card2];
+    }
+
+    int showdown(int hand, int oppHand) const {
+        return m_showdown[hand*m_numHands + oppHand];
+    }
+
+    // probability of dealing `hand` to one player and `oppHand` to the other
+    double chance(int hand, int oppHand) const {
+        return m_chance[hand*m_numHands + oppHand];
+    }
+
+    std::vector<int> deck() const {
+        std::vector<int> cards(deckSize());
+        for (int c=0; c<deckSize(); c++)
+            cards[c] = c;
+        return cards;
+    }
+
+    Betting child(const Betting &b, int action) const {
+        Betting c = b;
+        c.depth++;
+        if (b.depth > 0 && action <= b.level) {
+            c.terminal = true;
+            if (action == b.level)
+                c.showdownStake = m_stakes[action];
+            else
+                c.foldPayoff = b.committed[b.player()];
+            return c;
+        }
+        c.mask |= 1 << action;
+        c.level = std::max(b.level, action);
+        c.committed[b.player()] = m_stakes[action];
+        return c;
+    }
+
+private:
+    int m_values, m_copies, m_numActions, m_numHands;
+    std::vector<int> m_stakes;
+    HandIndexer m_indexer;
+    std::vector<int> m_pairHands, m_showdown;
+    std::vector<double> m_chance;
+
+    static std::vector<int> doublingStakes(int raises) {
+        std::vector<int> stakes;
+        for (int a=0; a<=raises && a<30; a++)
+            stakes.push_back(1 << a);
+        return stakes;
+    }
+
+    static int checkDeck(int values, int copies) {
+        if (values < 2 || copies < 1 || values*copies < 4)
+            throw std::runtime_error("the deck needs at least two values and four cards");
+        return values;
+    }
+
+    // pairs beat unpaired hands, which are compared by their high card and
+    // then their low card
+    int strength(int hand) const {
+        int low = lowValue(hand), high = highValue(hand);
+        return low == high ? m_values*m_values + high : high*m_values + low;
+    }
+};
+
+// How a Monte Carlo CFR iteration samples the tree. Chance sampling deals
+// one hand pair and walks every action, as KuhnPokerTwoCardsCFR does.
+// External sampling also samples the opponent's actions, walking every
+// action only at the traversing player's nodes. Outcome sampling follows a
+// single path, exploring with probability EXPLORATION at the traverser's
+// nodes and weighting regrets by the inverse of the path's probability.
+// External and outcome sampling traverse once for each player per
+// iteration. Full iterations sample nothing: they walk the public tree once
+// per player with vectors over every hand, as VectorCFR does for the fixed
+// games, so they converge deterministically.
+enum class Sampling { Chance, External, Outcome, Full };
+
+inline Sampling parseSampling(const std::string &name) {
+    if (name == "chance")
+        return Sampling::Chance;
+    if (name == "external")
+        return Sampling::External;
+    if (name == "outcome")
+        return Sampling::Outcome;
+    if (name == "full")
+        return Sampling::Full;
+    throw std::runtime_error("unknown sampling " + name + " (chance, external, outcome or full)");
+}
+
+// stakes written as e.g. "1,2,4"
+inline std::vector<int> parseStakes(const std::string &text) {
+    std::vector<int> stakes;
+    std::size_t start = 0;
+    while (start <= text.size()) {
+        std::size_t end = std::min(text.find(',', start), text.size());
+        stakes.push_back(std::atoi(text.substr(start, end - start).c_str()));
+        start = end + 1;
+    }
+    return stakes;
+}
+
+inline const char *samplingName(Sampling sampling) {
+    return sampling == Sampling::Chance ? "chance" : sampling == Sampling::External ? "external"
+         : sampling == Sampling::Outcome ? "outcome" : "full";
+}
+
+class MonteCarloTwoCardsCFR {
+    typedef TwoCardKuhnVariant Game;
+    typedef Game::Betting Betting;
+    static const int MAX_ACTIONS = Game::MAX_ACTIONS;
+    typedef std::array<double, MAX_ACTIONS> Strategy;
+public:
+    static constexpr double EXPLORATION = 0.6;
+    static const uint64_t SEED = 9;
+
+    // keeps its own copy of the game
+    MonteCarloTwoCardsCFR(const Game &game, Sampling sampling)
+        : m_game(game), m_sampling(sampling), m_numActions(game.numActions()), m_deck(game.deck()),
+          m_nodes(game.numInfosets(), game.numActions()), m_rng(SEED) {}
+
+    // seed of the deals and sampled actions; full iterations sample nothing
+    void setSeed(uint64_t seed) {
+        m_rng.seed(seed);
+    }
+
+    // Run iterations without any output, returning the summed estimate of
+    // the game value for the first player
+    double iterate(long iterations) {
+        double util = 0.0;
+        m_iterations += iterations;
+        for (long i=0; i<iterations; i++) {
+            if (m_sampling == Sampling::Full) {
+                std::vector<double> reach(m_game.numHands(), 1.0);
+                for (double value : fullWidth(m_game.root(), 0, reach, reach))
+                    util += value;
+                fullWidth(m_game.root(), 1, reach, reach);
+                continue;
+            }
+            deal();
+            if (m_sampling == Sampling::Chance) {
+                util += chanceSampled(m_game.root(), 1.0, 1.0);
+            } else if (m_sampling == Sampling::External) {
+                util += external(m_game.root(), 0);
+                external(m_game.root(), 1);
+            } else {
+                double tail;
+                outcome(m_game.root(), 0, 1.0, 1.0, 1.0, tail);
+                util += m_sampledValue;
+                outcome(m_game.root(), 1, 1.0, 1.0, 1.0, tail);
+            }
+        }
+        return util;
+    }
+
+    // Exploitability of the average strategy in chips per game: the mean of
+    // what each player wins by best responding to the other, computed over
+    // the public tree with vectors over all hands
+    double exploitability() const {
+        double total = 0.0;
+        for (int player=0; player<2; player++) {
+            std::vector<double> oppReach(m_game.numHands(), 1.0);
+            for (double value : bestResponse(m_game.root(), player, oppReach))
+                total += value;
+        }
+        return total / 2;
+    }
+
+    // Seeds the nodes from a solution of `previous`, a game that may differ
+    // in its deck and stakes, given by the regret and strategy sums of every
+    // node, node-major. A node is carried over when `previous` has the same
+    // betting history and can deal the same card values, and keeps the sums
+    // of the actions both games have; the rest start from zero. The sums are
+    // scaled so that the previous solution weighs as much as `weight`
+    // iterations of `previousIterations`, since a solution trained for long
+    // would otherwise take as long again to unlearn what the rule change
+    // invalidated. Returns the number of nodes seeded.
+    int warmStart(const Game &previous, const double *regretSums, const double *strategySums,
+                  long previousIterations, long weight) {
+        double scale = previousIterations > weight ? weight / (double)previousIterations : 1.0;
+        int numActions = std::min(m_numActions, previous.numActions()), seeded = 0;
+        int numHistories = std::min(m_game.numHistories(), previous.numHistories());
+        for (int h=0; h<m_game.numHands(); h++) {
+            int oldHand = previous.handOfValues(m_game.lowValue(h), m_game.highValue(h));
+            if (oldHand < 0)
+                continue;
+            for (int mask=0; mask<numHistories; mask++) {
+                Node n = m_nodes[mask*m_game.numHands() + h];
+                std::size_t old = (std::size_t)(mask*previous.numHands() + oldHand) * previous.numActions();
+                for (int a=0; a<numActions; a++) {
+                    n.regretSum[a] = scale * regretSums[old + a];
+                    n.strategySum[a] = scale * strategySums[old + a];
+                }
+                seeded++;
+            }
+        }
+        return seeded;
+    }
+
+    // seeds the nodes from another trainer's solution (see above)
+    int warmStart(const MonteCarloTwoCardsCFR &previous, long weight) {
+        return warmStart(previous.m_game, previous.sums(true).data(), previous.sums(false).data(),
+                         previous.m_iterations, weight);
+    }
+
+    // Seeds the nodes from a checkpoint of a trainer of `previous` (see
+    // above), which must be the game the checkpoint records
+    int warmStart(const Game &previous, const std::string &path, long weight) {
+        MappedCheckpoint checkpoint(path, GameId::KuhnPokerTwoCardsVariant, previous.numInfosets(),
+                                    previous.numActions());
+        if (checkpoint.header().parameters != previous.parameters())
+            throw std::runtime_error("checkpoint solved " + Game::fromCheckpoint(path).rulesName() + ", not "
+                                     + previous.rulesName() + ": " + path);
+        return warmStart(previous, checkpoint.regretSums(), checkpoint.strategySums(), checkpoint.iterations(),
+                         weight);
+    }
+
+    void saveCheckpoint(const std::string &path) const {
+        writeCheckpoint(path, GameId::KuhnPokerTwoCardsVariant, m_iterations, m_nodes.size(), m_numActions,
+                        sums(true).data(), sums(false).data(), 0, m_game.parameters());
+    }
+
+    void train(long iterations) {
+        using Clock = std::chrono::steady_clock;
+        double util = 0.0;
+        auto start = Clock::now();
+        for (long i=0; i<iterations; i+=1000000) {
+            std::cout << "Training " << 100.0*i/(double)iterations << "\% done\n";
+            util += iterate(std::min(1000000L, iterations-i));
+        }
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        std::cout << samplingName(m_sampling) << " sampling, " << m_deck.size() << " cards, "
+                  << m_numActions << " bet levels, " << m_nodes.size() << " infosets\n";
+        std::cout << "Node storage: " << m_nodes.size() << " nodes of " << m_nodes.nodeBytes() << " bytes ("
+                  << m_nodes.size()*m_nodes.nodeBytes()/1024.0 << " KiB)\n";
+        std::cout << "Time per iteration: " << 1e9*seconds/iterations << " ns\n";
+        std::cout << "Average game value: " << util/iterations << "\n";
+        std::cout << "Exploitability: " << 1000*exploitability() << " mbb/g\n";
+    }
+
+private:
+    typedef NodeArena::Node Node;
+
+    Game m_game;
+    Sampling m_sampling;
+    int m_numActions;
+    std::vector<int> m_deck;
+    std::array<int, 2> m_hands {0};
+    NodeArena m_nodes;
+    Rng m_rng;
+    long m_iterations = 0;
+    // importance-weighted estimate of the traverser's value from the last
+    // outcome-sampled path
+    double m_sampledValue = 0.0;
+
+    // the regret or else the strategy sums of every node, node-major
+    std::vector<double> sums(bool regrets) const {
+        std::vector<double> values;
+        for (std::size_t i=0; i<m_nodes.size(); i++)
+            for (int a=0; a<m_numActions; a++)
+                values.push_back(regrets ? (double)m_nodes[i].regretSum[a] : (double)m_nodes[i].strategySum[a]);
+        return values;
+    }
+
+    void deal() {
+        partialShuffle(m_deck.data(), m_deck.size(), 4, m_rng);
+        m_hands[0] = m_game.hand(m_deck[0], m_deck[1]);
+        m_hands[1] = m_game.hand(m_deck[2], m_deck[3]);
+    }
+
+    Node node(const Betting &b, int hand) const {
+        return m_nodes[b.mask*m_game.numHands() + hand];
+    }
+
+    // current strategy, from regret matching on the accumulated regrets
+    Strategy getStrategy(const Node &node) const {
+        Strategy strategy;
+        double normalisingSum = 0.0;
+        for (int a=0; a<m_numActions; a++) {
+            strategy[a] = std::max<double>(node.regretSum[a], 0.0);
+            normalisingSum += strategy[a];
+        }
+        for (int a=0; a<m_numActions; a++)
+            strategy[a] = normalisingSum > 0 ? strategy[a] / normalisingSum : 1.0 / m_numActions;
+        return strategy;
+    }
+
+    Strategy getAverageStrategy(const Node &node) const {
+        Strategy strategy;
+        double normalisingSum = 0.0;
+        for (int a=0; a<m_numActions; a++)
+            normalisingSum += node.strategySum[a];
+        for (int a=0; a<m_numActions; a++)
+            strategy[a] = normalisingSum > 0 ? node.strategySum[a] / normalisingSum : 1.0 / m_numActions;
+        return strategy;
+    }
+
+    int sampleAction(const Strategy &probabilities) {
+        double r = m_rng.uniform();
+        int a = 0;
+        while (a < m_numActions - 1 && r >= probabilities[a])
+            r -= probabilities[a++];
+        return a;
+    }
+
+    // payoff of a terminal history for `player`
+    double payoff(const Betting &b, int player) const {
+        int toAct = b.player();
+        double value = b.foldPayoff + b.showdownStake*m_game.showdown(m_hands[toAct], m_hands[1-toAct]);
+        return player == toAct ? value : -value;
+    }
+
+    // the chance-sampled walk of every action, returning the value for the
+    // player to act
+    double chanceSampled(const Betting &b, double p0, double p1) {
+        if (b.terminal)
+            return payoff(b, b.player());
+
+        int player = b.player();
+        Node n = node(b, m_hands[player]);
+        Strategy strategy = getStrategy(n);
+        double realisationWeight = player == 0 ? p0 : p1;
+        for (int a=0; a<m_numActions; a++)
+            n.strategySum[a] += realisationWeight * strategy[a];
+        Strategy util;
+        double nodeUtil = 0.0;
+        for (int a=0; a<m_numActions; a++) {
+            Betting child = m_game.child(b, a);
+            if (player == 0)
+                util[a] = -chanceSampled(child, p0*strategy[a], p1);
+            else
+                util[a] = -chanceSampled(child, p0, p1*strategy[a]);
+            nodeUtil += strategy[a] * util[a];
+        }
+        for (int a=0; a<m_numActions; a++)
+            n.regretSum[a] += (player == 0 ? p1 : p0) * (util[a] - nodeUtil);
+        return nodeUtil;
+    }
+
+    // External sampling, returning the traverser's sampled value. Sampling
+    // the opponent's actions from its current strategy makes its reach
+    // cancel out of the traverser's regrets, and the opponent's strategy
+    // sums are updated unweighted for the same reason.
+    double external(const Betting &b, int traverser) {
+        if (b.terminal)
+            return payoff(b, traverser);
+
+        int player = b.player();
+        Node n = node(b, m_hands[player]);
+        Strategy strategy = getStrategy(n);
+        if (player != traverser) {
+            for (int a=0; a<m_numActions; a++)
+                n.strategySum[a] += strategy[a];
+            return external(m_game.child(b, sampleAction(strategy)), traverser);
+        }
+
+        Strategy util;
+        double nodeUtil = 0.0;
+        for (int a=0; a<m_numActions; a++) {
+            util[a] = external(m_game.child(b, a), traverser);
+            nodeUtil += strategy[a] * util[a];
+        }
+        for (int a=0; a<m_numActions; a++)
+            n.regretSum[a] += util[a] - nodeUtil;
+        return nodeUtil;
+    }
+
+    // Outcome sampling. Returns the traverser's terminal utility divided by
+    // the probability `sample` of having sampled the path to it, and sets
+    // `tail` to the probability of the rest of the path under the current
+    // strategies. Reaches are the traverser's and the opponent's.
+    double outcome(const Betting &b, int traverser, double reach, double oppReach, double sample, double &tail) {
+        if (b.terminal) {
+            tail = 1.0;
+            m_sampledValue = payoff(b, traverser) * reach * oppReach / sample;
+            return payoff(b, traverser) / sample;
+        }
+
+        int player = b.player();
+        Node n = node(b, m_hands[player]);
+        Strategy strategy = getStrategy(n), probabilities = strategy;
+        if (player == traverser)
+            for (int a=0; a<m_numActions; a++)
+                probabilities[a] = EXPLORATION / m_numActions + (1 - EXPLORATION) * strategy[a];
+        int action = sampleAction(probabilities);
+
+        double childTail, util;
+        Betting child = m_game.child(b, action);
+        if (player == traverser) {
+            util = outcome(child, traverser, reach*strategy[action], oppReach, sample*probabilities[action], childTail);
+            double weighted = util * oppReach;
+            for (int a=0; a<m_numActions; a++)
+                n.regretSum[a] += a == action ? weighted * childTail * (1 - strategy[action])
+                                              : -weighted * childTail * strategy[action];
+        } else {
+            util = outcome(child, traverser, reach, oppReach*strategy[action], sample*probabilities[action], childTail);
+            for (int a=0; a<m_numActions; a++)
+                n.strategySum[a] += oppReach / sample * strategy[a];
+        }
+        tail = childTail * strategy[action];
+        return util;
+    }
+
+    // The full-width walk for `traverser`, returning the counterfactual value
+    // of each of its hands given its own and its opponent's reach of every
+    // hand
+    std::vector<double> fullWidth(const Betting &b, int traverser, const std::vector<double> &reach,
+                                  const std::vector<double> &oppReach) {
+        int numHands = m_game.numHands();
+        if (b.terminal)
+            return terminalValues(b, traverser, oppReach);
+
+        std::vector<Strategy> strategy(numHands);
+        for (int h=0; h<numHands; h++)
+            strategy[h] = getStrategy(node(b, h));
+        std::vector<double> values(numHands, 0.0), childReach(numHands);
+        if (b.player() != traverser) {
+            for (int a=0; a<m_numActions; a++) {
+                for (int h=0; h<numHands; h++)
+                    childReach[h] = oppReach[h] * strategy[h][a];
+                std::vector<double> childValues = fullWidth(m_game.child(b, a), traverser, reach, childReach);
+                for (int h=0; h<numHands; h++)
+                    values[h] += childValues[h];
+            }
+            return values;
+        }
+
+        std::vector<std::vector<double>> util(m_numActions);
+        for (int a=0; a<m_numActions; a++) {
+            for (int h=0; h<numHands; h++)
+                childReach[h] = reach[h] * strategy[h][a];
+            util[a] = fullWidth(m_game.child(b, a), traverser, childReach, oppReach);
+            for (int h=0; h<numHands; h++)
+                values[h] += strategy[h][a] * util[a][h];
+        }
+        for (int h=0; h<numHands; h++) {
+            Node n = node(b, h);
+            for (int a=0; a<m_numActions; a++) {
+                n.regretSum[a] += util[a][h] - values[h];
+                n.strategySum[a] += reach[h] * strategy[h][a];
+            }
+        }
+        return values;
+    }
+
+    // the value to `player` of each of its hands at a terminal history,
+    // weighted by the chance of the deal and the opponent's reach
+    std::vector<double> terminalValues(const Betting &b, int player, const std::vector<double> &oppReach) const {
+        int numHands = m_game.numHands();
+        std::vector<double> values(numHands, 0.0);
+        double foldPayoff = b.player() == player ? b.foldPayoff : -b.foldPayoff;
+        for (int h=0; h<numHands; h++)
+            for (int o=0; o<numHands; o++)
+                values[h] += m_game.chance(h, o) * oppReach[o] * (foldPayoff + b.showdownStake*m_game.showdown(h, o));
+        return values;
+    }
+
+    // the responder's best-response counterfactual value of each hand
+    // against the opponent's average strategy
+    std::vector<double> bestResponse(const Betting &b, int responder, const std::vector<double> &oppReach) const {
+        int numHands = m_game.numHands();
+        std::vector<double> values(numHands, 0.0);
+        if (b.terminal)
+            return terminalValues(b, responder, oppReach);
+
+        if (b.player() == responder) {
+            for (int a=0; a<m_numActions; a++) {
+                std::vector<double> childValues = bestResponse(m_game.child(b, a), responder, oppReach);
+                for (int h=0; h<numHands; h++)
+                    values[h] = a == 0 ? childValues[h] : std::max(values[h], childValues[h]);
+            }
+            return values;
+        }
+
+        std::vector<Strategy> strategy(numHands);
+        for (int h=0; h<numHands; h++)
+            strategy[h] = getAverageStrategy(node(b, h));
+        std::vector<double> childReach(numHands);
+        for (int a=0; a<m_numActions; a++) {
+            for (int h=0; h<numHands; h++)
+                childReach[h] = oppReach[h] * strategy[h][a];
+            std::vector<double> childValues = bestResponse(m_game.child(b, a), responder, childReach);
+            for (int h=0; h<numHands; h++)
+                values[h] += childValues[h];
+        }
+        return values;
+    }
+};
+
+// For each deck of 4 to maxValues card values (with `copies` of each), each
+// number of raises from 2 to maxRaises and each sampling scheme, trains a
+// fresh trainer for `seconds` and prints as CSV the time per iteration and
+// the exploitability reached. The cost of a chance-sampled iteration grows
+// with the size of the betting tree, that of the sampled walks only with
+// its depth; the deck only changes how many infosets there are to learn.
+inline void reportDeckScaling(int maxValues, int copies, int maxRaises, double seconds) {
+    using Clock = std::chrono::steady_clock;
+    std::cout << "cards,bet_levels,infosets,sampling,ns_per_iteration,iterations,exploitability_mbb\n";
+    for (int values=4; values<=maxValues; values+=2) {
+        for (int raises=2; raises<=maxRaises; raises++) {
+            TwoCardKuhnVariant game(values, copies, raises);
+            for (Sampling sampling : {Sampling::Chance, Sampling::External, Sampling::Outcome}) {
+                MonteCarloTwoCardsCFR trainer(game, sampling);
+                long iterations = 0;
+                double elapsed = 0.0;
+                while (elapsed < seconds) {
+                    auto start = Clock::now();
+                    trainer.iterate(10000);
+                    elapsed += std::chrono::duration<double>(Clock::now() - start).count();
+                    iterations += 10000;
+                }
+                std::cout << game.deckSize() << "," << game.numActions() << "," << game.numInfosets() << ","
+                          << samplingName(sampling) << "," << 1e9*elapsed/iterations << "," << iterations << ","
+                          << 1000*trainer.exploitability() << "\n";
+            }
+        }
+    }
+}
+
+// Trains `trainer` until its exploitability is below `target` mbb/g or it
+// has run maxIterations, checking every 2% of the iterations so far (and
+// before the first). Sets the iterations and seconds taken and returns the
+// exploitability reached.
+inline double trainToTarget(MonteCarloTwoCardsCFR &trainer, double target, long maxIterations, long &iterations,
+                            double &seconds) {
+    using Clock = std::chrono::steady_clock;
+    iterations = 0;
+    seconds = 0.0;
+    double exploitability = 1000*trainer.exploitability();
+    while (exploitability >= target && iterations < maxIterations) {
+        long batch = std::min(maxIterations - iterations, std::max(100L, iterations / 50));
+        auto start = Clock::now();
+        trainer.iterate(batch);
+        seconds += std::chrono::duration<double>(Clock::now() - start).count();
+        iterations += batch;
+        exploitability = 1000*trainer.exploitability();
+    }
+    return exploitability;
+}
+
+// Trains `base` to `target` mbb/g, then changes one rule at a time (the top
+// stake, an extra bet level, a copy fewer of each card, an extra card
+// value) and trains the changed game to the target twice: from scratch and
+// warm-started from the base solution, weighted as `weight` iterations.
+// Prints as CSV the iterations and seconds each start took, with the
+// cold start's time over the warm one's. Every trainer samples with
+// `seed`, so that runs of several seeds can be compared. Sampled
+// iterations reach a tight target mostly by averaging out their noise,
+// which a warm start cannot shorten, so full iterations show its effect
+// best.
+inline void reportWarmStart(const TwoCardKuhnVariant &base, Sampling sampling, double target, long maxIterations,
+                            long weight, uint64_t seed) {
+    std::cout << "values,copies,stakes,start,infosets,seeded_infosets,initial_exploitability_mbb,iterations,seconds,"
+              << "exploitability_mbb,reached_target,speedup\n";
+    MonteCarloTwoCardsCFR solved(base, sampling);
+    solved.setSeed(seed);
+    long iterations;
+    double initial = 1000*solved.exploitability(), seconds;
+    double exploitability = trainToTarget(solved, target, maxIterations, iterations, seconds);
+    std::cout << base.values() << "," << base.copies() << "," << base.stakesName() << ",cold," << base.numInfosets()
+              << ",0," << initial << "," << iterations << "," << seconds << "," << exploitability << ","
+              << (exploitability < target ? "yes" : "no") << ",1\n";
+
+    std::vector<int> higherTop = base.stakes(), extraLevel = base.stakes();
+    higherTop.back()++;
+    extraLevel.push_back(2 * extraLevel.back());
+    std::vector<TwoCardKuhnVariant> tweaks {TwoCardKuhnVariant(base.values(), base.copies(), higherTop)};
+    if (extraLevel.size() <= TwoCardKuhnVariant::MAX_ACTIONS)
+        tweaks.emplace_back(base.values(), base.copies(), extraLevel);
+    if (base.copies() > 1 && base.values() * (base.copies() - 1) >= 4)
+        tweaks.emplace_back(base.values(), base.copies() - 1, base.stakes());
+    tweaks.emplace_back(base.values() + 1, base.copies(), base.stakes());
+    for (const TwoCardKuhnVariant &game : tweaks) {
+        double coldSeconds = 0.0;
+        for (bool warm : {false, true}) {
+            MonteCarloTwoCardsCFR trainer(game, sampling);
+            trainer.setSeed(seed);
+            int seeded = warm ? trainer.warmStart(solved, weight) : 0;
+            initial = 1000*trainer.exploitability();
+            exploitability = trainToTarget(trainer, target, maxIterations, iterations, seconds);
+            if (!warm)
+                coldSeconds = seconds;
+            std::cout << game.values() << "," << game.copies() << "," << game.stakesName() << ","
+                      << (warm ? "warm" : "cold") << "," << game.numInfosets() << "," << seeded << "," << initial << ","
+                      << iterations << "," << seconds << "," << exploitability << ","
+                      << (exploitability < target ? "yes" : "no") << "," << coldSeconds / seconds << "\n";
+        }
+    }
+}
@@ -0,0 +1,154 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cmath>
+#include <memory>
+#include <new>
+
+// Storage for CFR nodes.
+//
+// Strategy sums are only ever normalised into an average strategy, so they
+// can be kept in single precision to shrink nodes: build with
+// -DCFR_FLOAT_STRATEGY_SUMS. A float sum stops growing once it is about
+// 2^24 times the size of one update, so this suits full-width training more
+// than runs of hundreds of millions of sampled iterations.
+#ifdef CFR_FLOAT_STRATEGY_SUMS
+typedef float StrategySum;
+#else
+typedef double StrategySum;
+#endif
+
+// A regret sum in 32-bit fixed point, 1/SCALE per unit. Updates are
+// rounded to the nearest unit and saturate at the ends of the range, which
+// floors regrets at about -500000 as CFR+ floors them at 0: a regret only
+// matters once it is positive, so a floor just bounds how long an action
+// that has been bad takes to come back. Positive regrets must stay inside
+// the range, so every policy in RegretPolicy.h keeps single updates
+// bounded by the game's payoffs rather than growing them with the
+// iteration.
+class ScaledRegret {
+public:
+    static constexpr double SCALE = 4096.0;
+
+    ScaledRegret(double value = 0.0) {
+        *this = value;
+    }
+
+    operator double() const {
+        return m_value / SCALE;
+    }
+
+    ScaledRegret &operator=(double value) {
+        m_value = saturate(std::llrint(value * SCALE));
+        return *this;
+    }
+
+    ScaledRegret &operator+=(double delta) {
+        m_value = saturate(m_value + std::llrint(delta * SCALE));
+        return *this;
+    }
+
+    ScaledRegret &operator+=(ScaledRegret delta) {
+        m_value = saturate((long long)m_value + delta.m_value);
+        return *this;
+    }
+
+    ScaledRegret &operator*=(double factor) {
+        return *this = *this * factor;
+    }
+
+private:
+    int32_t m_value;
+
+    static int32_t saturate(long long value) {
+        return value > INT32_MAX ? INT32_MAX : value < INT32_MIN ? INT32_MIN : value;
+    }
+};
+
+// Regret sums are doubles, floats with -DCFR_FLOAT_REGRETS or ScaledRegret
+// with -DCFR_INT32_REGRETS. Together with float strategy sums either halves
+// a node. Read them as doubles, e.g. std::max<double>(regret, 0.0).
+#if defined(CFR_INT32_REGRETS)
+typedef ScaledRegret Regret;
+static constexpr const char *REGRET_STORAGE = "int32";
+#elif defined(CFR_FLOAT_REGRETS)
+typedef float Regret;
+static constexpr const char *REGRET_STORAGE = "float";
+#else
+typedef double Regret;
+static constexpr const char *REGRET_STORAGE = "double";
+#endif
+
+static const std::size_t CACHE_LINE = 64;
+
+// Bytes a node of `size` bytes takes when nodes are packed so that none
+// straddles a cache line: the next power of two up to a line, and whole
+// lines beyond that. Node types align to it and NodeArena strides by it.
+constexpr std::size_t nodeStride(std::size_t size) {
+    if (size > CACHE_LINE)
+        return (size + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+    std::size_t stride = sizeof(double);
+    while (stride < size)
+        stride *= 2;
+    return stride;
+}
+
+// bytes of the regret and strategy sums of a node with numActions actions
+constexpr std::size_t nodeSize(std::size_t numActions) {
+    return (numActions * sizeof(Regret) + alignof(StrategySum) - 1) / alignof(StrategySum) * alignof(StrategySum)
+         + numActions * sizeof(StrategySum);
+}
+
+// Nodes whose number of actions is only known at run time, all in one
+// cache-line-aligned block. Each node holds its regret sums followed by its
+// strategy sums, padded to nodeStride(), so visiting a node touches a single
+// line. The block is freed with the arena.
+class NodeArena {
+public:
+    struct Node {
+        Regret *regretSum;
+        StrategySum *strategySum;
+    };
+
+    NodeArena(std::size_t numNodes, int numActions)
+        : m_sumsOffset(nodeSize(numActions) - numActions * sizeof(StrategySum)),
+          m_stride(nodeStride(nodeSize(numActions))),
+          m_numNodes(numNodes) {
+        std::size_t bytes = (numNodes * m_stride + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+        void *data = std::aligned_alloc(CACHE_LINE, bytes);
+        if (!data)
+            throw std::bad_alloc();
+        m_data.reset(static_cast<unsigned char *>(data));
+        for (std::size_t i=0; i<numNodes; i++) {
+            Node n = (*this)[i];
+            for (int a=0; a<numActions; a++) {
+                n.regretSum[a] = 0.0;
+                n.strategySum[a] = 0.0;
+            }
+        }
+    }
+
+    Node operator[](std::size_t i) const {
+        unsigned char *node = m_data.get() + i*m_stride;
+        return {reinterpret_cast<Regret *>(node), reinterpret_cast<StrategySum *>(node + m_sumsOffset)};
+    }
+
+    std::size_t size() const {
+        return m_numNodes;
+    }
+
+    std::size_t nodeBytes() const {
+        return m_stride;
+    }
+
+private:
+    struct Free {
+        void operator()(unsigned char *p) const {
+            std::free(p);
+        }
+    };
+
+    std::size_t m_sumsOffset, m_stride, m_numNodes;
+    std::unique_ptr<unsigned char, Free> m_data;
+};
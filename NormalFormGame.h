@@ -0,0 +1,618 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <array>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "Parallel.h"
+#include "Checkpoint.h"
+#include "Exploitability.h"
+#include "Rng.h"
+
+// Regret matching for two-player zero-sum normal-form games given by the
+// first player's payoff matrix: u(a, b) is what it wins playing action a
+// when the opponent plays b, and the opponent wins -u(a, b). The players
+// may have different numbers of actions.
+//
+// A matrix is held row-major, either in memory or mapped from a file of a
+// 64-byte header followed by the payoffs, so that matrices larger than
+// memory stream from the page cache.
+
+enum class PayoffType : uint32_t {
+    Int8 = 1,
+    Float = 2,
+    Double = 3,
+};
+
+template <typename Payoff> struct PayoffTypeOf;
+template <> struct PayoffTypeOf<int8_t> { static const PayoffType VALUE = PayoffType::Int8; };
+template <> struct PayoffTypeOf<float> { static const PayoffType VALUE = PayoffType::Float; };
+template <> struct PayoffTypeOf<double> { static const PayoffType VALUE = PayoffType::Double; };
+
+inline PayoffType parsePayoffType(const std::string &name) {
+    if (name == "int8")
+        return PayoffType::Int8;
+    if (name == "float")
+        return PayoffType::Float;
+    if (name == "double")
+        return PayoffType::Double;
+    throw std::runtime_error("unknown payoff type " + name + " (int8, float or double)");
+}
+
+// Calls f with a value of the C++ type of payoffs of `type`
+template <typename F>
+void withPayoffType(PayoffType type, F f) {
+    switch (type) {
+        case PayoffType::Int8: f(int8_t()); break;
+        case PayoffType::Float: f(float()); break;
+        case PayoffType::Double: f(double()); break;
+        default: throw std::runtime_error("unknown payoff type " + std::to_string((uint32_t)type));
+    }
+}
+
+struct MatrixHeader {
+    static constexpr char MAGIC[8] = {'C', 'F', 'R', 'G', 'A', 'M', 'E', '\0'};
+    static const uint32_t VERSION = 1;
+
+    char magic[8];
+    uint32_t version;
+    PayoffType type;
+    uint64_t rows;
+    uint64_t cols;
+    uint8_t reserved[32];
+};
+static_assert(sizeof(MatrixHeader) == 64, "payoffs must start 64 bytes in");
+
+// Reads and validates the header of the matrix file at `path`
+inline MatrixHeader readMatrixHeader(const std::string &path) {
+    MatrixHeader header;
+    FILE *file = std::fopen(path.c_str(), "rb");
+    if (!file)
+        throw std::runtime_error("cannot open matrix " + path);
+    bool ok = std::fread(&header, sizeof(header), 1, file) == 1;
+    std::fclose(file);
+    if (!ok || std::memcmp(header.magic, MatrixHeader::MAGIC, sizeof(header.magic)) != 0)
+        throw std::runtime_error("not a matrix: " + path);
+    if (header.version != MatrixHeader::VERSION)
+        throw std::runtime_error("unsupported matrix version " + std::to_string(header.version) + ": " + path);
+    return header;
+}
+
+// Writes a rows x cols matrix to `path` one row at a time, fill(a, row)
+// setting the payoffs of row a, so that matrices larger than memory can be
+// generated. Like checkpoints, it is written next to `path` and renamed.
+template <typename Payoff, typename Fill>
+void writeMatrix(const std::string &path, uint64_t rows, uint64_t cols, Fill fill) {
+    MatrixHeader header {};
+    std::memcpy(header.magic, MatrixHeader::MAGIC, sizeof(header.magic));
+    header.version = MatrixHeader::VERSION;
+    header.type = PayoffTypeOf<Payoff>::VALUE;
+    header.rows = rows;
+    header.cols = cols;
+
+    std::string tmpPath = path + ".tmp";
+    FILE *file = std::fopen(tmpPath.c_str(), "wb");
+    if (!file)
+        throw std::runtime_error("cannot write matrix " + tmpPath);
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+    std::vector<Payoff> row(cols);
+    for (uint64_t a=0; ok && a<rows; a++) {
+        fill(a, row.data());
+        ok = std::fwrite(row.data(), sizeof(Payoff), cols, file) == cols;
+    }
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok || std::rename(tmpPath.c_str(), path.c_str()) != 0)
+        throw std::runtime_error("failed writing matrix " + path);
+}
+
+// A row-major payoff matrix, owned or mapped read-only from a file
+template <typename Payoff>
+class PayoffMatrix {
+public:
+    // a zero matrix in memory
+    PayoffMatrix(int rows, int cols) : m_rows(rows), m_cols(cols), m_owned((size_t)rows * cols) {
+        m_data = m_owned.data();
+    }
+
+    // the matrix of a game given by utility(a, b), in memory
+    template <typename Utility>
+    static PayoffMatrix generate(int rows, int cols, Utility utility) {
+        PayoffMatrix matrix(rows, cols);
+        for (int a=0; a<rows; a++)
+            for (int b=0; b<cols; b++)
+                matrix.m_owned[(size_t)a*cols + b] = utility(a, b);
+        return matrix;
+    }
+
+    // the matrix saved at `path`, which must hold payoffs of this type
+    static PayoffMatrix map(const std::string &path) {
+        MatrixHeader header = readMatrixHeader(path);
+        if (header.type != PayoffTypeOf<Payoff>::VALUE)
+            throw std::runtime_error("matrix holds another payoff type: " + path);
+        if (header.rows == 0 || header.cols == 0 || header.rows > INT32_MAX || header.cols > INT32_MAX)
+            throw std::runtime_error("bad matrix shape: " + path);
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("cannot open matrix " + path);
+        size_t size = sizeof(MatrixHeader) + header.rows * header.cols * sizeof(Payoff);
+        struct stat st;
+        if (fstat(fd, &st) != 0 || (size_t)st.st_size < size) {
+            ::close(fd);
+            throw std::runtime_error("truncated matrix " + path);
+        }
+        void *data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (data == MAP_FAILED)
+            throw std::runtime_error("cannot map matrix " + path);
+
+        PayoffMatrix matrix(0, 0);
+        matrix.m_rows = header.rows;
+        matrix.m_cols = header.cols;
+        matrix.m_map = data;
+        matrix.m_mapSize = size;
+        matrix.m_data = reinterpret_cast<const Payoff *>(static_cast<const char *>(data) + sizeof(MatrixHeader));
+        return matrix;
+    }
+
+    PayoffMatrix(PayoffMatrix &&other) noexcept
+        : m_rows(other.m_rows), m_cols(other.m_cols), m_owned(std::move(other.m_owned)),
+          m_map(other.m_map), m_mapSize(other.m_mapSize) {
+        m_data = m_map ? other.m_data : m_owned.data();
+        other.m_map = nullptr;
+    }
+
+    PayoffMatrix(const PayoffMatrix &) = delete;
+    PayoffMatrix &operator=(const PayoffMatrix &) = delete;
+
+    ~PayoffMatrix() {
+        if (m_map)
+            munmap(m_map, m_mapSize);
+    }
+
+    int rows() const {
+        return m_rows;
+    }
+
+    int cols() const {
+        return m_cols;
+    }
+
+    bool mapped() const {
+        return m_map != nullptr;
+    }
+
+    const Payoff *row(int a) const {
+        return m_data + (size_t)a*m_cols;
+    }
+
+    Payoff operator()(int a, int b) const {
+        return m_data[(size_t)a*m_cols + b];
+    }
+
+    // the transpose, in memory
+    PayoffMatrix transposed() const {
+        PayoffMatrix matrix(m_cols, m_rows);
+        for (int a=0; a<m_rows; a++)
+            for (int b=0; b<m_cols; b++)
+                matrix.m_owned[(size_t)b*m_rows + a] = (*this)(a, b);
+        return matrix;
+    }
+
+    void write(const std::string &path) const {
+        writeMatrix<Payoff>(path, m_rows, m_cols, [this](uint64_t a, Payoff *row) {
+            std::copy(this->row(a), this->row(a) + m_cols, row);
+        });
+    }
+
+private:
+    int m_rows, m_cols;
+    std::vector<Payoff> m_owned;
+    void *m_map = nullptr;
+    size_t m_mapSize = 0;
+    const Payoff *m_data;
+};
+
+// Regret matching on a payoff matrix, either sampling an action per player
+// per iteration or, in full-width mode, updating every action with its
+// expected utility against the other player's mixed strategy.
+//
+// An in-memory matrix keeps a transposed copy, so that both players'
+// payoffs against an action are a contiguous row. Sampled iterations then
+// read two rows, and the matrix-vector products of full-width iterations
+// sum the rows of the actions played with nonzero probability. A mapped
+// matrix is too big to copy: sampling reads a strided column, and both
+// products are taken in one pass over the matrix. Products are walked in
+// blocks of columns so that the slices of the vectors a block touches stay
+// in L1 while the rows stream past.
+//
+// In parallel training the shared regrets, and so the strategies, are fixed
+// for a round, so each round builds an alias table per player from which
+// workers sample actions in constant time.
+template <typename Payoff>
+class NormalFormCFR {
+public:
+    // columns per block of a matrix-vector product: 2 x 16 KiB of doubles
+    static const int COLUMN_BLOCK = 2048;
+
+    NormalFormCFR(PayoffMatrix<Payoff> matrix, GameId game)
+        : m_matrix(std::move(matrix)),
+          m_columns(m_matrix.mapped() ? PayoffMatrix<Payoff>(0, 0) : m_matrix.transposed()), m_game(game) {
+        for (int p=0; p<2; p++)
+            m_regretSum[p] = m_strategySum[p] = m_strategy[p] = m_utility[p] = std::vector<double>(numActions(p), 0.0);
+        m_cumulative = std::vector<double>(std::max(numActions(0), numActions(1)));
+    }
+
+    // actions of the first (0) or second (1) player
+    int numActions(int player) const {
+        return player == 0 ? m_matrix.rows() : m_matrix.cols();
+    }
+
+    const PayoffMatrix<Payoff> &matrix() const {
+        return m_matrix;
+    }
+
+    void train(int iterations) {
+        int i = 0;
+        while (i < iterations) {
+            int n = m_monitor.steps(m_iterations, std::min(100000 - i % 100000, iterations - i));
+            iterate(n);
+            i += n;
+            if (!m_checkpointPath.empty() && m_iterations >= m_nextCheckpoint) {
+                saveCheckpoint(m_checkpointPath);
+                m_nextCheckpoint = m_iterations + m_checkpointInterval;
+            }
+            if (m_monitor.update(m_iterations, "per game", [this] { return exploitability(); }))
+                break;
+        }
+        if (!m_checkpointPath.empty())
+            saveCheckpoint(m_checkpointPath);
+    }
+
+    // Evaluate exploitability every `interval` iterations of train(),
+    // logging the curve to `logPath` if given and stopping once it is
+    // below `target`
+    void setEvaluation(long interval, double target, const std::string &logPath) {
+        m_monitor.configure(interval, target, logPath, m_iterations);
+    }
+
+    // Save a checkpoint to `path` every `interval` iterations of train()
+    // and when it finishes
+    void setCheckpoint(const std::string &path, long interval) {
+        m_checkpointPath = path;
+        m_checkpointInterval = interval;
+        m_nextCheckpoint = m_iterations + interval;
+    }
+
+    // The checkpoint holds one node per player, with actions in matrix
+    // order. If the players have different numbers of actions the smaller
+    // node is padded with zeros.
+    void saveCheckpoint(const std::string &path) const {
+        int width = std::max(numActions(0), numActions(1));
+        std::vector<double> regretSums(2*width), strategySums(2*width);
+        for (int p=0; p<2; p++) {
+            std::copy(m_regretSum[p].begin(), m_regretSum[p].end(), &regretSums[p*width]);
+            std::copy(m_strategySum[p].begin(), m_strategySum[p].end(), &strategySums[p*width]);
+        }
+        writeCheckpoint(path, m_game, m_iterations, 2, width, regretSums.data(), strategySums.data());
+    }
+
+    // Restore the tables and iteration count saved in a checkpoint, to
+    // continue training from it
+    void loadCheckpoint(const std::string &path) {
+        int width = std::max(numActions(0), numActions(1));
+        MappedCheckpoint checkpoint(path, m_game, 2, width);
+        for (int p=0; p<2; p++) {
+            const double *regretSums = checkpoint.regretSums() + p*width;
+            const double *strategySums = checkpoint.strategySums() + p*width;
+            m_regretSum[p].assign(regretSums, regretSums + numActions(p));
+            m_strategySum[p].assign(strategySums, strategySums + numActions(p));
+        }
+        m_iterations = checkpoint.iterations();
+        m_nextCheckpoint = m_iterations + m_checkpointInterval;
+    }
+
+    // Seed the random numbers of serial training and, as separate streams,
+    // of each worker thread
+    void setSeed(uint64_t seed) {
+        m_seed = seed;
+        m_rng.seed(seed);
+        for (size_t t=0; t<m_workers.size(); t++)
+            m_workers[t].rng.seed(seed, t + 1);
+    }
+
+    // Train with the given number of worker threads, merging their updates
+    // every syncInterval iterations in all, syncInterval/threads per thread,
+    // so that strategies are not held for longer as threads are added. One
+    // thread still goes through the parallel path; without a call training
+    // is serial.
+    void setThreads(int threads, long syncInterval) {
+        m_syncInterval = std::max(1L, syncInterval / threads);
+        m_workers = std::vector<Worker>(threads);
+        for (int t=0; t<threads; t++) {
+            Worker &w = m_workers[t];
+            w.rng.seed(m_seed, t + 1);
+            for (int p=0; p<2; p++)
+                w.regretSum[p] = std::vector<double>(numActions(p), 0.0);
+        }
+    }
+
+    // Train against the opponent's whole mixed strategy instead of a
+    // sampled action, updating the players together or, if `alternating`,
+    // one after the other. Full-width training is serial.
+    void setFullWidthMode(bool alternating) {
+        m_fullWidth = true;
+        m_alternating = alternating;
+    }
+
+    // Run iterations, returning the summed utility of the first player
+    double iterate(long iterations) {
+        m_iterations += iterations;
+        if (m_fullWidth) {
+            double util = 0.0;
+            for (long i=0; i<iterations; i++)
+                util += fullWidthIteration();
+            return util;
+        }
+        if (m_workers.empty()) {
+            double util = 0.0;
+            for (long i=0; i<iterations; i++) {
+                int myAction = sampleStrategy(m_regretSum[0], m_strategySum[0], m_rng.uniform(), m_cumulative);
+                int oppAction = sampleStrategy(m_regretSum[1], m_strategySum[1], m_rng.uniform(), m_cumulative);
+                util += updateRegrets(myAction, oppAction, m_regretSum);
+            }
+            return util;
+        }
+
+        // every iteration of a round plays the round's strategies, which are
+        // added to the strategy sums once per round
+        auto work = [this](int thread, long n) {
+            Worker &w = m_workers[thread];
+            for (long i=0; i<n; i++) {
+                int myAction = m_alias[0].sample(w.rng), oppAction = m_alias[1].sample(w.rng);
+                w.util += updateRegrets(myAction, oppAction, w.regretSum);
+            }
+            w.iterations = n;
+        };
+        auto merge = [this] {
+            long roundIterations = 0;
+            for (Worker &w : m_workers) {
+                for (int p=0; p<2; p++) {
+                    for (int a=0; a<numActions(p); a++)
+                        m_regretSum[p][a] += w.regretSum[p][a];
+                    std::fill(w.regretSum[p].begin(), w.regretSum[p].end(), 0.0);
+                }
+                roundIterations += w.iterations;
+            }
+            for (int p=0; p<2; p++)
+                for (int a=0; a<numActions(p); a++)
+                    m_strategySum[p][a] += roundIterations * m_strategy[p][a];
+            startRound();
+        };
+        startRound();
+        runParallelRounds(m_workers.size(), iterations, m_syncInterval, work, merge);
+        double util = 0.0;
+        for (Worker &w : m_workers) {
+            util += w.util;
+            w.util = 0.0;
+        }
+        return util;
+    }
+
+    // Exploitability of the average strategies, in utility per game: the
+    // mean of what each player wins by best responding to the other's
+    // strategy. It is zero exactly at a Nash equilibrium.
+    double exploitability() {
+        std::vector<double> strategy = getAverageStrategy(0), oppStrategy = getAverageStrategy(1);
+        products(strategy.data(), oppStrategy.data(), m_utility[0].data(), m_utility[1].data());
+        double best = *std::max_element(m_utility[0].begin(), m_utility[0].end());
+        double oppBest = *std::max_element(m_utility[1].begin(), m_utility[1].end());
+        return (best + oppBest) / 2;
+    }
+
+    // average strategies of both players, in action order
+    std::vector<double> getAverageStrategies() const {
+        std::vector<double> strategies = getAverageStrategy(0), oppStrategy = getAverageStrategy(1);
+        strategies.insert(strategies.end(), oppStrategy.begin(), oppStrategy.end());
+        return strategies;
+    }
+
+    std::vector<double> getAverageStrategy(int player = 0) const {
+        std::vector<double> strategy(numActions(player));
+        currentStrategy(m_strategySum[player], strategy);
+        return strategy;
+    }
+
+private:
+    PayoffMatrix<Payoff> m_matrix;
+    PayoffMatrix<Payoff> m_columns;   // transpose of an in-memory matrix
+    GameId m_game;
+
+    // indexed by player
+    typedef std::array<std::vector<double>, 2> Sums;
+    Sums m_regretSum;
+    Sums m_strategySum;
+    Sums m_strategy, m_utility;       // full-width or parallel round strategies
+    std::vector<double> m_cumulative;
+
+    uint64_t m_seed = 0;
+    Rng m_rng;
+
+    // Per-thread state for parallel training: a private RNG stream, and the
+    // regrets accumulated and iterations run during the current round.
+    struct Worker {
+        Rng rng;
+        Sums regretSum;
+        long iterations = 0;
+        double util = 0.0;
+    };
+    std::vector<Worker> m_workers;
+    long m_syncInterval = 10000;
+    std::array<AliasTable, 2> m_alias;
+
+    bool m_fullWidth = false, m_alternating = false;
+
+    long m_iterations = 0;
+    std::string m_checkpointPath;
+    long m_checkpointInterval = 0, m_nextCheckpoint = 0;
+
+    ExploitabilityMonitor m_monitor;
+
+    // computes the strategies of a parallel round from the shared regrets
+    void startRound() {
+        for (int p=0; p<2; p++) {
+            currentStrategy(m_regretSum[p], m_strategy[p]);
+            m_alias[p].build(m_strategy[p].data(), numActions(p));
+        }
+    }
+
+    // Adds both players' regrets for the sampled actions to regretSum,
+    // returning the first player's utility
+    double updateRegrets(int myAction, int oppAction, Sums &regretSum) const {
+        // the first player's payoffs against oppAction are a column
+        double util = m_matrix(myAction, oppAction);
+        if (m_columns.rows() > 0) {
+            const Payoff *column = m_columns.row(oppAction);
+            for (int a=0; a<numActions(0); a++)
+                regretSum[0][a] += column[a] - column[myAction];
+        } else {
+            for (int a=0; a<numActions(0); a++)
+                regretSum[0][a] += m_matrix(a, oppAction) - util;
+        }
+
+        // and the opponent's, negated, against myAction are a row
+        const Payoff *row = m_matrix.row(myAction);
+        for (int b=0; b<numActions(1); b++)
+            regretSum[1][b] += row[oppAction] - row[b];
+        return util;
+    }
+
+    // Adds the current strategy for regretSum to strategySum and samples an
+    // action from it with the uniform random number r, using `cumulative`
+    // for its cumulative distribution
+    int sampleStrategy(const std::vector<double> &regretSum, std::vector<double> &strategySum, double r,
+                       std::vector<double> &cumulative) const {
+        int n = regretSum.size();
+        double normalizingSum = 0.0;
+        for (int a=0; a<n; a++)
+            normalizingSum += regretSum[a] > 0 ? regretSum[a] : 0;
+        double cumulativeProb = 0.0;
+        for (int a=0; a<n; a++) {
+            double p = normalizingSum > 0 ? (regretSum[a] > 0 ? regretSum[a] : 0) / normalizingSum : 1.0 / n;
+            strategySum[a] += p;
+            cumulativeProb += p;
+            cumulative[a] = cumulativeProb;
+        }
+        int a = std::upper_bound(cumulative.begin(), cumulative.begin() + n, r) - cumulative.begin();
+        return std::min(a, n - 1);
+    }
+
+    // One iteration of regret matching in which each player's regrets are
+    // updated with the expected utility of every action against the other's
+    // mixed strategy. With alternating updates the opponent sees the first
+    // player's new strategy. Returns the first player's expected utility.
+    double fullWidthIteration() {
+        for (int p=0; p<2; p++)
+            currentStrategy(m_regretSum[p], m_strategy[p]);
+        if (m_alternating) {
+            products(nullptr, m_strategy[1].data(), m_utility[0].data(), nullptr);
+            double util = update(0);
+            currentStrategy(m_regretSum[0], m_strategy[0]);
+            products(m_strategy[0].data(), nullptr, nullptr, m_utility[1].data());
+            update(1);
+            return util;
+        }
+        products(m_strategy[0].data(), m_strategy[1].data(), m_utility[0].data(), m_utility[1].data());
+        double util = update(0);
+        update(1);
+        return util;
+    }
+
+    // Adds a player's regrets for the utilities in m_utility and its
+    // strategy to its strategy sum, returning its expected utility
+    double update(int player) {
+        std::vector<double> &strategy = m_strategy[player], &utility = m_utility[player];
+        double util = 0.0;
+        for (int a=0; a<numActions(player); a++)
+            util += strategy[a] * utility[a];
+        for (int a=0; a<numActions(player); a++) {
+            m_regretSum[player][a] += utility[a] - util;
+            m_strategySum[player][a] += strategy[a];
+        }
+        return util;
+    }
+
+    // Sets utility to the first player's expected utility of each action
+    // against oppStrategy, and oppUtility to the opponent's against
+    // strategy, skipping either whose output is null
+    void products(const double *strategy, const double *oppStrategy, double *utility, double *oppUtility) const {
+        int rows = numActions(0), cols = numActions(1);
+        if (utility)
+            std::fill(utility, utility + rows, 0.0);
+        if (oppUtility)
+            std::fill(oppUtility, oppUtility + cols, 0.0);
+        if (m_columns.rows() > 0) {
+            if (utility)
+                addRows(m_columns, oppStrategy, 1.0, utility);
+            if (oppUtility)
+                addRows(m_matrix, strategy, -1.0, oppUtility);
+            return;
+        }
+        for (int first=0; first<cols; first+=COLUMN_BLOCK) {
+            int last = std::min(cols, first + COLUMN_BLOCK);
+            for (int a=0; a<rows; a++) {
+                const Payoff *row = m_matrix.row(a);
+                if (utility) {
+                    // four sums, so that additions do not wait on each other
+                    double sums[4] = {0.0, 0.0, 0.0, 0.0};
+                    int b = first;
+                    for (; b+4<=last; b+=4)
+                        for (int k=0; k<4; k++)
+                            sums[k] += oppStrategy[b+k] * row[b+k];
+                    for (; b<last; b++)
+                        sums[0] += oppStrategy[b] * row[b];
+                    utility[a] += (sums[0] + sums[1]) + (sums[2] + sums[3]);
+                }
+                if (oppUtility && strategy[a] != 0) {
+                    double p = strategy[a];
+                    for (int b=first; b<last; b++)
+                        oppUtility[b] -= p * row[b];
+                }
+            }
+        }
+    }
+
+    // Adds sign*weights[r] times row r of matrix to out for every row r.
+    // Regret matching gives many actions zero probability, and their rows
+    // are skipped.
+    static void addRows(const PayoffMatrix<Payoff> &matrix, const double *weights, double sign, double *out) {
+        for (int first=0; first<matrix.cols(); first+=COLUMN_BLOCK) {
+            int last = std::min(matrix.cols(), first + COLUMN_BLOCK);
+            for (int r=0; r<matrix.rows(); r++) {
+                if (weights[r] == 0)
+                    continue;
+                const Payoff *row = matrix.row(r);
+                double w = sign * weights[r];
+                for (int c=first; c<last; c++)
+                    out[c] += w * row[c];
+            }
+        }
+    }
+
+    // the regret-matching strategy for regretSum, or the average strategy
+    // for a strategy sum
+    static void currentStrategy(const std::vector<double> &regretSum, std::vector<double> &strategy) {
+        int n = regretSum.size();
+        double normalizingSum = 0.0;
+        for (int a=0; a<n; a++)
+            normalizingSum += regretSum[a] > 0 ? regretSum[a] : 0;
+        for (int a=0; a<n; a++)
+            strategy[a] = normalizingSum > 0 ? (regretSum[a] > 0 ? regretSum[a] : 0) / normalizingSum : 1.0 / n;
+    }
+};
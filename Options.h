@@ -0,0 +1,40 @@
+#pragma once
+#include <string>
+#include <map>
+#include <cstdlib>
+
+// Command line options of the form --name value, or --name on its own for
+// flags. Unknown options are ignored so every trainer can share one parser.
+class Options {
+public:
+    Options(int argc, char **argv) {
+        for (int i=1; i<argc; i++) {
+            std::string arg = argv[i];
+            if (arg.rfind("--", 0) != 0)
+                continue;
+            std::string value = "1";
+            if (i+1 < argc && std::string(argv[i+1]).rfind("--", 0) != 0)
+                value = argv[++i];
+            m_values[arg.substr(2)] = value;
+        }
+    }
+
+    bool has(const std::string &name) const {
+        return m_values.count(name) > 0;
+    }
+
+    long getInt(const std::string &name, long defaultValue) const {
+        return has(name) ? std::atol(m_values.at(name).c_str()) : defaultValue;
+    }
+
+    double getDouble(const std::string &name, double defaultValue) const {
+        return has(name) ? std::atof(m_values.at(name).c_str()) : defaultValue;
+    }
+
+    std::string getString(const std::string &name, const std::string &defaultValue) const {
+        return has(name) ? m_values.at(name) : defaultValue;
+    }
+
+private:
+    std::map<std::string, std::string> m_values;
+};
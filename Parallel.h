@@ -0,0 +1,87 @@
+#pragma once
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <stdexcept>
+
+// Runs `iterations` training iterations across numThreads workers in
+// rounds. In each round every worker calls work(thread, n) for its share of
+// syncInterval*numThreads iterations, accumulating into its own buffers and
+// only reading the shared tables. Once all workers have finished, merge()
+// folds the buffers into the shared tables, so no locks or atomics are
+// needed and the result does not depend on thread scheduling.
+template <typename Work, typename Merge>
+void runParallelRounds(int numThreads, long iterations, long syncInterval, Work work, Merge merge) {
+    std::vector<std::thread> workers;
+    for (long done = 0; done < iterations; ) {
+        long round = std::min(iterations - done, syncInterval*numThreads);
+        workers.clear();
+        for (int t=0; t<numThreads; t++)
+            workers.emplace_back(work, t, round/numThreads + (t < round % numThreads ? 1 : 0));
+        for (std::thread &worker : workers)
+            worker.join();
+        merge();
+        done += round;
+    }
+}
+
+// What reportScaling checks against its tolerance: the largest difference
+// of any average strategy probability from the serial run's, or of the
+// average game value. Games with a family of equilibria (Kuhn poker) can
+// converge to different strategies, so there the game value is the one to
+// compare.
+enum class ScalingCheck { Strategies, GameValue };
+
+// Trains a fresh Trainer for `iterations` iterations serially and then with
+// 1, 2, 4, ... maxThreads threads, printing as CSV the iterations/second,
+// the speedup over the serial run, and how far the average game value and
+// average strategies end up from the serial run's, with the tolerance the
+// checked one must be within. Throws once every row is printed if any
+// threaded run is outside it.
+//
+// Trainer needs setThreads(threads, syncInterval), iterate(n) returning the
+// summed game value, and getAverageStrategies() returning every average
+// strategy probability.
+template <typename Trainer>
+void reportScaling(long iterations, long syncInterval, int maxThreads, ScalingCheck check, double tolerance) {
+    using Clock = std::chrono::steady_clock;
+    std::vector<int> threadCounts {0};
+    for (int threads=1; threads<maxThreads; threads*=2)
+        threadCounts.push_back(threads);
+    threadCounts.push_back(maxThreads);
+
+    std::vector<double> reference;
+    double serialRate = 0.0, serialValue = 0.0, worst = 0.0;
+    std::cout << "threads,iterations_per_second,speedup,game_value,value_difference,max_strategy_difference,"
+              << (check == ScalingCheck::Strategies ? "strategy" : "value") << "_tolerance\n";
+    for (int threads : threadCounts) {
+        Trainer trainer;
+        if (threads > 0)
+            trainer.setThreads(threads, syncInterval);
+        auto start = Clock::now();
+        double value = trainer.iterate(iterations) / iterations;
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        double rate = iterations / seconds;
+        std::vector<double> strategies = trainer.getAverageStrategies();
+        if (threads == 0) {
+            reference = strategies;
+            serialRate = rate;
+            serialValue = value;
+        }
+        double difference = 0.0;
+        for (size_t i=0; i<strategies.size(); i++)
+            difference = std::max(difference, std::fabs(strategies[i] - reference[i]));
+        double checked = check == ScalingCheck::Strategies ? difference : std::fabs(value - serialValue);
+        worst = std::max(worst, checked);
+        std::cout << (threads == 0 ? "serial" : std::to_string(threads)) << "," << rate << ","
+                  << rate/serialRate << "," << value << "," << std::fabs(value - serialValue) << ","
+                  << difference << "," << tolerance << "\n";
+    }
+    if (worst > tolerance)
+        throw std::runtime_error("threaded training ended " + std::to_string(worst) + " from serial, outside the "
+                                 + "tolerance of " + std::to_string(tolerance));
+}
@@ -0,0 +1,904 @@
+#pragma once
+#include <iostream>
+#include <array>
+#include <string>
+#include <map>
+#include <memory>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <stdexcept>
+#include "Options.h"
+#include "Allocations.h"
+#include "Benchmark.h"
+#include "Parallel.h"
+#include "PublicTree.h"
+#include "VectorCFR.h"
+#include "Checkpoint.h"
+#include "Exploitability.h"
+#include "RegretPolicy.h"
+#include "NodeStorage.h"
+#include "Rng.h"
+#include "Telemetry.h"
+#include "Pruning.h"
+#include "Distributed.h"
+#include "StrategyTable.h"
+
+// The chance-sampled CFR engine shared by the poker trainers. A game is a
+// traits type, so the compiler specialises every walk for it and inlines
+// its deal, terminal test, payoff and information-set lookup; there are no
+// virtual calls. Game provides:
+//
+//     NUM_ACTIONS, NUM_INFOSETS   actions per decision point, table size
+//     SAMPLED_NODES               decision points one sampled walk visits
+//     MAX_REGRET_STEP             most an iteration can change a regret,
+//                                 per unit of opponent reach
+//     ID, SEED, ITERATIONS        checkpoint game, default seed and
+//                                 default number of training iterations
+//     Deal                        the private cards of one deal
+//     Deck                        deal(rng, deal) samples the next Deal
+//     History                     the public betting so far, starting at
+//                                 the root: push(action), pop(), depth(),
+//                                 player() to act, isTerminal(), and for
+//                                 the player to act payoff(deal) at a
+//                                 terminal and infoset(deal) elsewhere, and
+//                                 subtreeSize(action), the decision points
+//                                 one sampled walk visits below an action.
+//                                 MAX_DEPTH bounds depth().
+//     Vector                      a full-width engine over all deals, with
+//                                 iterate<Policy>(nodes, t) and
+//                                 exploitability(nodes), as VectorCFR.h
+//     infoSetName(index)          the name an information set prints as
+//
+// A History may leave the player to act unchanged across an action, as at
+// a chance node between rounds, so values are negated only when it changes.
+
+// One information set's regret and strategy sums. Aligned so that no node
+// straddles a cache line.
+template <int NUM_ACTIONS>
+class alignas(nodeStride(nodeSize(NUM_ACTIONS))) PokerNode {
+public:
+    std::array<Regret, NUM_ACTIONS> regretSum {0.0};
+    std::array<StrategySum, NUM_ACTIONS> strategySum {0.0};
+
+    std::array<double, NUM_ACTIONS> getAverageStrategy() const {
+        std::array<double, NUM_ACTIONS> avgStrategy;
+        double normalisingSum = 0.0;
+        for (int a=0; a<NUM_ACTIONS; a++)
+            normalisingSum += strategySum[a];
+        for (int a=0; a<NUM_ACTIONS; a++) {
+            if (normalisingSum > 0)
+                avgStrategy[a] = strategySum[a] / normalisingSum;
+            else
+                avgStrategy[a] = 1.0 / NUM_ACTIONS;
+        }
+        return avgStrategy;
+    }
+
+    // Current strategy, from regret matching on the accumulated regrets.
+    // Shared by every policy's walks, it has too many callers for GCC to
+    // inline it unasked, and the call costs the sampled walk about 15%.
+    __attribute__((always_inline)) std::array<double, NUM_ACTIONS> getStrategy() const {
+        std::array<double, NUM_ACTIONS> strategy;
+        double normalisingSum = 0.0;
+        for (int a=0; a<NUM_ACTIONS; a++) {
+            strategy[a] = std::max<double>(regretSum[a], 0.0);
+            normalisingSum += strategy[a];
+        }
+        for (int a=0; a<NUM_ACTIONS; a++) {
+            if (normalisingSum > 0)
+                strategy[a] /= normalisingSum;
+            else
+                strategy[a] = 1.0 / NUM_ACTIONS;
+        }
+        return strategy;
+    }
+
+    std::string toString(const std::string &infoSet) const {
+        std::array<double, NUM_ACTIONS> avgStrategy = getAverageStrategy();
+        std::string res = infoSet + ": [";
+        for (int a=0; a<NUM_ACTIONS; a++)
+            res += (a ? ", " : "") + std::to_string(avgStrategy[a]);
+        return res + "]";
+    }
+};
+
+// Policy is the regret-update rule, one of those in RegretPolicy.h
+template <typename Game, typename Policy = VanillaCFR>
+class PokerCFR {
+    static const int NUM_ACTIONS = Game::NUM_ACTIONS;
+    static const int NUM_INFOSETS = Game::NUM_INFOSETS;
+    typedef typename Game::Deal Deal;
+    typedef typename Game::Deck Deck;
+    typedef typename Game::History History;
+public:
+    static const int MAX_BATCH = 256;
+
+private:
+    typedef PokerNode<NUM_ACTIONS> Node;
+    typedef std::array<Node, NUM_INFOSETS> NodeTable;
+    NodeTable m_nodes;
+
+    // The lanes of a batched walk, one per deal: its cards and, per depth
+    // of the public tree, the reach probabilities and utilities of every
+    // lane, along with the current strategy of every information set and
+    // the regret and strategy-sum contributions of the batch, which are only
+    // added to the nodes once it has been walked.
+    struct Batch {
+        static const int MAX_DEPTH = History::MAX_DEPTH;
+        typedef std::array<double, MAX_BATCH> Lanes;
+        int size = 0;
+        std::array<Deal, MAX_BATCH> deals;
+        std::array<Lanes, MAX_DEPTH+1> reach0, reach1, util;
+        std::array<std::array<Lanes, NUM_ACTIONS>, MAX_DEPTH> actionUtil;
+        std::array<std::array<double, NUM_ACTIONS>, NUM_INFOSETS> strategy, regrets, strategySums;
+    };
+
+    // Per-thread state for parallel training: a private RNG, deck, deal and
+    // history, and the regret and strategy-sum deltas of the current round.
+    struct Worker {
+        Rng rng;
+        Deck deck;
+        Deal deal;
+        History history;
+        Batch batch;
+        NodeTable deltas;
+        Telemetry telemetry;
+        PruningCounts pruning;
+        long deals = 0;
+        double util = 0.0;
+    };
+    std::vector<Worker> m_workers;
+    long m_syncInterval = 1000;
+    Cluster *m_cluster = nullptr;
+
+    typename Game::Vector m_vector;
+    bool m_vectorMode = false;
+    int m_batchSize = 0;
+
+    // Regret-based pruning (see Pruning.h): with an interval, every deal is
+    // walked once per player, skipping actions whose regret is below
+    // m_pruneBelow on all but every interval-th deal
+    long m_pruneInterval = 0;
+    double m_pruneBelow = 0.0;
+    PruningCounts m_pruning;
+
+    long m_iterations = 0;
+    std::string m_checkpointPath;
+    long m_checkpointInterval = 0, m_nextCheckpoint = 0;
+
+    ExploitabilityMonitor m_monitor;
+    Telemetry m_telemetry;
+    TelemetryReporter m_reporter;
+
+    // Iteration of the regret-update policy and its weights. A vector CFR
+    // iteration is one policy iteration; chance-sampled training counts one
+    // every syncInterval deals per thread.
+    long m_policyIteration = 1;
+    double m_regretWeight = Policy::regretWeight(1), m_strategyWeight = Policy::strategyWeight(1);
+
+public:
+    // Seed the deals of serial training and, as separate streams, of each
+    // worker thread
+    void setSeed(uint64_t seed) {
+        m_seed = seed;
+        m_rng.seed(seed);
+        for (size_t t=0; t<m_workers.size(); t++)
+            m_workers[t].rng.seed(seed, t + 1);
+        if (m_cluster)
+            m_workers[0].rng.seed(seed, m_cluster->rank() + 1);
+    }
+
+    // Train with the given number of worker threads, merging their updates
+    // every syncInterval iterations in all, syncInterval/threads per thread,
+    // so that strategies are not held for longer as threads are added. One
+    // thread still goes through the parallel path; without a call training
+    // is serial.
+    void setThreads(int threads, long syncInterval) {
+        m_syncInterval = std::max(1L, syncInterval / threads);
+        m_workers = std::vector<Worker>(threads);
+        for (int t=0; t<threads; t++)
+            m_workers[t].rng.seed(m_seed, t + 1);
+        setPolicyIteration(m_iterations / (m_syncInterval * threads) + 1);
+    }
+
+    // Train as one process of `cluster` (see Distributed.h), syncing every
+    // syncInterval iterations in all, as setThreads() does. Each process
+    // walks the deals thread `rank` would, serially, so a cluster of N
+    // processes trains as setThreads(N, syncInterval) does.
+    void setCluster(Cluster &cluster, long syncInterval) {
+        cluster.handshake(Game::ID, Policy::ID, NUM_INFOSETS, NUM_ACTIONS, syncInterval);
+        m_cluster = &cluster;
+        m_syncInterval = std::max(1L, syncInterval / cluster.size());
+        m_workers = std::vector<Worker>(1);
+        m_workers[0].rng.seed(m_seed, cluster.rank() + 1);
+        setPolicyIteration(m_iterations / (m_syncInterval * cluster.size()) + 1);
+    }
+
+    // Train with full-width vector CFR over all deals instead of sampling
+    // one deal per iteration. Vector training is serial.
+    void setVectorMode() {
+        if (m_batchSize > 0)
+            throw std::runtime_error("vector training deals no batches");
+        m_vectorMode = true;
+    }
+
+    // Deal `size` hands at a time and walk the tree once for all of them,
+    // with the strategies of the nodes as they were before the batch. The
+    // batch's regrets are added up per information set and applied after
+    // it, so a batch of one is an ordinary iteration. Worker threads and
+    // cluster processes batch their share of a round, whose strategies are
+    // frozen anyway, so there batching changes only the speed. Batches
+    // cannot be pruned, and vector training has no deals to batch.
+    void setBatchSize(int size) {
+        if (size < 1 || size > MAX_BATCH)
+            throw std::runtime_error("batch size must be 1 to " + std::to_string(MAX_BATCH));
+        if (m_vectorMode)
+            throw std::runtime_error("vector training deals no batches");
+        if (m_pruneInterval > 0)
+            throw std::runtime_error("batches cannot be pruned");
+        m_batchSize = size;
+    }
+
+    // Walk each deal once per player, pruning actions that cannot regain
+    // positive regret within `interval` deals on all but every interval-th
+    // one. An interval of 1 walks once per player without pruning. Vector
+    // training ignores it.
+    void setPruning(long interval) {
+        if (interval < 1)
+            throw std::runtime_error("pruning interval must be positive");
+        if (m_batchSize > 0)
+            throw std::runtime_error("batches cannot be pruned");
+        m_pruneInterval = interval;
+        setPolicyIteration(m_policyIteration);
+    }
+
+    // decision points visited and skipped by pruned walks so far
+    const PruningCounts &pruningCounts() const {
+        return m_pruning;
+    }
+
+    // bytes of one node of the table
+    long nodeBytes() const {
+        return sizeof(Node);
+    }
+
+    // Decision points whose regrets one iteration updates: every history of
+    // the dealt hands when sampling, every information set per pass when
+    // vectorised
+    long nodesPerIteration() const {
+        if (m_vectorMode)
+            return NUM_INFOSETS * (Policy::ALTERNATING ? 2 : 1);
+        return Game::SAMPLED_NODES;
+    }
+
+    // Save a checkpoint to `path` every `interval` iterations of train()
+    // and when it finishes
+    void setCheckpoint(const std::string &path, long interval) {
+        m_checkpointPath = path;
+        m_checkpointInterval = interval;
+        m_nextCheckpoint = m_iterations + interval;
+    }
+
+    void saveCheckpoint(const std::string &path) const {
+        std::vector<double> regretSums(NUM_INFOSETS*NUM_ACTIONS), strategySums(NUM_INFOSETS*NUM_ACTIONS);
+        for (int i=0; i<NUM_INFOSETS; i++) {
+            for (int a=0; a<NUM_ACTIONS; a++) {
+                regretSums[i*NUM_ACTIONS + a] = m_nodes[i].regretSum[a];
+                strategySums[i*NUM_ACTIONS + a] = m_nodes[i].strategySum[a];
+            }
+        }
+        writeCheckpoint(path, Game::ID, m_iterations, NUM_INFOSETS, NUM_ACTIONS,
+                        regretSums.data(), strategySums.data(), Policy::ID);
+    }
+
+    // Restore the tables and iteration count saved in a checkpoint, to
+    // continue training from it
+    void loadCheckpoint(const std::string &path) {
+        MappedCheckpoint checkpoint(path, Game::ID, NUM_INFOSETS, NUM_ACTIONS);
+        if (checkpoint.policy() != Policy::ID)
+            throw std::runtime_error("checkpoint was trained with another policy: " + path);
+        const double *regretSums = checkpoint.regretSums(), *strategySums = checkpoint.strategySums();
+        for (int i=0; i<NUM_INFOSETS; i++) {
+            for (int a=0; a<NUM_ACTIONS; a++) {
+                m_nodes[i].regretSum[a] = regretSums[i*NUM_ACTIONS + a];
+                m_nodes[i].strategySum[a] = strategySums[i*NUM_ACTIONS + a];
+            }
+        }
+        m_iterations = checkpoint.iterations();
+        m_nextCheckpoint = m_iterations + m_checkpointInterval;
+        long parallel = m_cluster ? m_cluster->size() : std::max<long>(1, m_workers.size());
+        setPolicyIteration(m_iterations / (m_syncInterval * parallel) + 1);
+    }
+
+    // Print the average strategy stored in a checkpoint, read in place
+    // from the mapped file
+    static void printCheckpointStrategy(const std::string &path) {
+        MappedCheckpoint checkpoint(path, Game::ID, NUM_INFOSETS, NUM_ACTIONS);
+        std::cout << "Strategy after " << checkpoint.iterations() << " iterations:\n";
+        std::map<std::string, int> names;
+        for (int i=0; i<NUM_INFOSETS; i++)
+            names[Game::infoSetName(i)] = i;
+        for (auto &n : names) {
+            std::array<double, NUM_ACTIONS> strategy;
+            checkpoint.averageStrategy(n.second, strategy.data());
+            std::cout << "\t" << n.first << ":";
+            for (int a=0; a<NUM_ACTIONS; a++)
+                std::cout << (a ? ", " : " [") << strategy[a];
+            std::cout << "]\n";
+        }
+    }
+
+    // names of every infoset, in index order
+    static std::vector<std::string> infoSetNames() {
+        std::vector<std::string> names;
+        for (int i=0; i<NUM_INFOSETS; i++)
+            names.push_back(Game::infoSetName(i));
+        return names;
+    }
+
+    // The average strategy stored in a checkpoint, frozen for serving
+    static StrategyTable loadStrategyTable(const std::string &path) {
+        return StrategyTable(MappedCheckpoint(path, Game::ID, NUM_INFOSETS, NUM_ACTIONS), infoSetNames());
+    }
+
+    // Run iterations without any output, returning the summed game value
+    double iterate(long iterations) {
+        long first = m_iterations;
+        m_iterations += iterations;
+        if (m_vectorMode) {
+            double util = 0.0;
+            uint64_t mark = m_telemetry.now();
+            for (long i=0; i<iterations; i++)
+                util += m_vector.template iterate<Policy>(m_nodes, first + i + 1);
+            m_telemetry.lap(Phase::Traversal, mark);
+            // a vector pass visits and updates every information set
+            m_telemetry.add(Counter::NodeVisits, iterations * nodesPerIteration());
+            m_telemetry.add(Counter::RegretUpdates, iterations * nodesPerIteration());
+            return util;
+        }
+        if (m_workers.empty() && m_batchSize > 0) {
+            // batches end at policy iterations
+            double util = 0.0;
+            for (long done = 0; done < iterations; ) {
+                long size = std::min<long>({m_batchSize, iterations - done,
+                                            m_syncInterval - (first + done) % m_syncInterval});
+                util += batchIteration(size, m_rng, m_deck, m_history, m_batch, m_nodes, m_telemetry);
+                done += size;
+                if ((first + done) % m_syncInterval == 0) {
+                    uint64_t mark = m_telemetry.now();
+                    nextPolicyIteration();
+                    m_telemetry.lap(Phase::Update, mark);
+                }
+            }
+            return util;
+        }
+        if (m_workers.empty()) {
+            double util = 0.0;
+            uint64_t mark = m_telemetry.now();
+            for (long i=0; i<iterations; i++) {
+                m_deck.deal(m_rng, m_deal);
+                mark = m_telemetry.lap(Phase::Deal, mark);
+                util += walk(m_history, m_deal, first + i + 1, m_nodes, m_telemetry, m_pruning);
+                mark = m_telemetry.lap(Phase::Traversal, mark);
+                if ((first + i + 1) % m_syncInterval == 0) {
+                    nextPolicyIteration();
+                    mark = m_telemetry.lap(Phase::Update, mark);
+                }
+            }
+            return util;
+        }
+
+        auto work = [this](int thread, long n) {
+            Worker &worker = m_workers[thread];
+            if (m_batchSize > 0) {
+                for (long done = 0; done < n; done += m_batchSize)
+                    worker.util += batchIteration(std::min<long>(m_batchSize, n - done), worker.rng, worker.deck,
+                                                  worker.history, worker.batch, worker.deltas, worker.telemetry);
+                return;
+            }
+            uint64_t mark = worker.telemetry.now();
+            for (long i=0; i<n; i++) {
+                worker.deck.deal(worker.rng, worker.deal);
+                mark = worker.telemetry.lap(Phase::Deal, mark);
+                worker.util += walk(worker.history, worker.deal, ++worker.deals, worker.deltas, worker.telemetry,
+                                    worker.pruning);
+                mark = worker.telemetry.lap(Phase::Traversal, mark);
+            }
+        };
+        if (m_cluster) {
+            // this process's share of each round, split as runParallelRounds()
+            // splits it between threads
+            double util = 0.0;
+            int processes = m_cluster->size(), rank = m_cluster->rank();
+            Worker &worker = m_workers[0];
+            for (long done = 0; done < iterations; ) {
+                long round = std::min(iterations - done, m_syncInterval*processes);
+                work(0, round/processes + (rank < round % processes ? 1 : 0));
+                uint64_t mark = m_telemetry.now();
+                m_telemetry.merge(worker.telemetry);
+                m_pruning.merge(worker.pruning);
+                util += m_cluster->sync(m_nodes, worker.deltas, worker.util);
+                worker.util = 0.0;
+                worker.deltas.fill(Node());
+                nextPolicyIteration();
+                m_telemetry.lap(Phase::Update, mark);
+                done += round;
+            }
+            return util;
+        }
+        auto merge = [this] {
+            uint64_t mark = m_telemetry.now();
+            for (Worker &worker : m_workers) {
+                m_telemetry.merge(worker.telemetry);
+                m_pruning.merge(worker.pruning);
+                for (int i=0; i<NUM_INFOSETS; i++) {
+                    for (int a=0; a<NUM_ACTIONS; a++) {
+                        m_nodes[i].regretSum[a] += worker.deltas[i].regretSum[a];
+                        m_nodes[i].strategySum[a] += worker.deltas[i].strategySum[a];
+                    }
+                }
+                worker.deltas.fill(Node());
+            }
+            nextPolicyIteration();
+            m_telemetry.lap(Phase::Update, mark);
+        };
+        runParallelRounds(m_workers.size(), iterations, m_syncInterval, work, merge);
+        double util = 0.0;
+        for (Worker &worker : m_workers) {
+            util += worker.util;
+            worker.util = 0.0;
+        }
+        return util;
+    }
+
+    // exploitability of the average strategy, in chips per game
+    double exploitability() const {
+        return m_vector.exploitability(m_nodes);
+    }
+
+    // Evaluate exploitability every `interval` iterations of train(),
+    // logging the curve to `logPath` if given and stopping once it is
+    // below `target` mbb/g. The ante is the big blind, so one mbb is a
+    // thousandth of a chip.
+    void setEvaluation(long interval, double target, const std::string &logPath) {
+        m_monitor.configure(interval, target, logPath, m_iterations);
+    }
+
+    // Write telemetry every `interval` seconds of train(), appended to
+    // `logPath` and replacing `statusPath`, either of which may be empty.
+    // Node tables are allocated up front, so their nodes count as created
+    // here rather than during training.
+    void setTelemetry(const std::string &logPath, const std::string &statusPath, double interval) {
+        m_reporter.configure(logPath, statusPath, interval, m_iterations);
+        m_telemetry.add(Counter::NodeCreations, NUM_INFOSETS * (1 + m_workers.size()));
+    }
+
+    // average strategies of every infoset, in index order
+    std::vector<double> getAverageStrategies() {
+        std::vector<double> strategies;
+        for (Node &node : m_nodes)
+            for (double p : node.getAverageStrategy())
+                strategies.push_back(p);
+        return strategies;
+    }
+
+    // the current average strategy, frozen for serving
+    StrategyTable freeze() {
+        return StrategyTable(NUM_INFOSETS, NUM_ACTIONS, getAverageStrategies(), infoSetNames());
+    }
+
+    void train(long iterations) {
+        using Clock = std::chrono::steady_clock;
+        double util = 0.0;
+        long allocations = g_allocations.load(std::memory_order_relaxed);
+        auto start = Clock::now();
+        long i = 0;
+        while (i < iterations) {
+            if (i % 1000000 == 0)
+                std::cout << "Training " << 100.0*i/(double)iterations << "\% done\n";
+            long n = m_monitor.steps(m_iterations, std::min(1000000 - i % 1000000, iterations - i));
+            util += iterate(n);
+            i += n;
+            if (!m_checkpointPath.empty() && m_iterations >= m_nextCheckpoint) {
+                saveCheckpoint(m_checkpointPath);
+                m_nextCheckpoint = m_iterations + m_checkpointInterval;
+            }
+            m_reporter.update(m_iterations, m_telemetry);
+            if (m_monitor.update(m_iterations, "mbb/g", [this] { return 1000*exploitability(); }))
+                break;
+        }
+        m_reporter.update(m_iterations, m_telemetry, true);
+        if (!m_checkpointPath.empty())
+            saveCheckpoint(m_checkpointPath);
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        allocations = g_allocations.load(std::memory_order_relaxed) - allocations;
+        std::cout << "Heap allocations during training: " << allocations << " (" << allocations/(double)i
+                  << " per iteration)\n";
+        std::cout << "Node table: " << NUM_INFOSETS << " nodes of " << sizeof(Node) << " bytes ("
+                  << sizeof(NodeTable)/1024.0 << " KiB)\n";
+        std::cout << "Iterations per second: " << i/seconds << "\n";
+        if (m_cluster)
+            std::cout << "Cluster: " << m_cluster->size() << " processes, " << m_cluster->bytesPerSync()
+                      << " bytes sent and received per sync\n";
+        std::cout << "Average game value: " << util/i << "\n";
+        std::cout << "Exploitability: " << 1000*exploitability() << " mbb/g\nFinal Strategy:\n";
+        // print in infoset name order
+        std::map<std::string, int> names;
+        for (int n=0; n<NUM_INFOSETS; n++)
+            names[Game::infoSetName(n)] = n;
+        for (auto &n : names)
+            std::cout << "\t" << m_nodes[n.second].toString(n.first) << "\n";
+    }
+
+private:
+    uint64_t m_seed = Game::SEED;
+    Rng m_rng {m_seed};
+    Deck m_deck;
+    Deal m_deal;
+    History m_history;
+    Batch m_batch;
+
+    void setPolicyIteration(long t) {
+        m_policyIteration = t;
+        m_regretWeight = Policy::regretWeight(t);
+        m_strategyWeight = Policy::strategyWeight(t);
+        m_pruneBelow = -PRUNE_MARGIN * m_pruneInterval * Game::MAX_REGRET_STEP * m_regretWeight;
+    }
+
+    // Ends the current policy iteration of chance-sampled training
+    void nextPolicyIteration() {
+        if (Policy::TABLE_PASS)
+            for (Node &node : m_nodes)
+                Policy::endIteration(node, m_policyIteration);
+        setPolicyIteration(m_policyIteration + 1);
+    }
+
+    // Value of the child `history` has just been pushed to, for `player`,
+    // from the child's value for its player to act
+    static double childValue(const History &history, int player, double value) {
+        return history.player() == player ? value : -value;
+    }
+
+    // Regret and strategy-sum updates go to `deltas`, which is m_nodes
+    // itself when training serially and a worker's buffer otherwise. Both
+    // players are updated on every walk, even for alternating policies.
+    double cfr(History &history, const Deal &deal, double p0, double p1, NodeTable &deltas, Telemetry &telemetry) {
+        // Return payoff for terminal states
+        if (history.isTerminal()) {
+            telemetry.add(Counter::TerminalEvaluations);
+            return history.payoff(deal);
+        }
+        telemetry.add(Counter::NodeVisits);
+
+        int player = history.player();
+        int index = history.infoset(deal);
+        Node &delta = deltas[index];
+
+        // for each action, recursively call cfr with additional history and
+        // probability
+        std::array<double, NUM_ACTIONS> strategy = m_nodes[index].getStrategy();
+        double realisationWeight = player == 0 ? p0 : p1;
+        for (int a=0; a<NUM_ACTIONS; a++)
+            delta.strategySum[a] += m_strategyWeight * realisationWeight * strategy[a];
+        std::array<double, NUM_ACTIONS> util {0.0};
+        double nodeUtil = 0.0;
+        for (int a=0; a<NUM_ACTIONS; a++) {
+            history.push(a);
+            if (player == 0)
+                util[a] = childValue(history, player, cfr(history, deal, p0*strategy[a], p1, deltas, telemetry));
+            else
+                util[a] = childValue(history, player, cfr(history, deal, p0, p1*strategy[a], deltas, telemetry));
+            history.pop();
+            nodeUtil += strategy[a] * util[a];
+        }
+
+        // for each action, compute and accumulate counterfactual regret
+        for (int a=0; a<NUM_ACTIONS; a++) {
+            double regret = util[a] - nodeUtil;
+            delta.regretSum[a] += m_regretWeight * (player == 0 ? p1 : p0) * regret;
+        }
+        telemetry.add(Counter::RegretUpdates);
+
+        return nodeUtil;
+    }
+
+    // The walk of the `deal`th dealt hands of this thread: cfr() for both
+    // players at once, or with pruning one cfrPruned() per player, returning
+    // player 1's utility
+    double walk(History &history, const Deal &deal, long count, NodeTable &deltas, Telemetry &telemetry,
+                PruningCounts &pruning) {
+        if (m_pruneInterval == 0)
+            return cfr(history, deal, 1.0, 1.0, deltas, telemetry);
+        long sampling = count % m_pruneInterval == 0 ? m_pruneInterval : 0;
+        double util = cfrPruned(history, deal, 0, sampling, 1.0, 1.0, deltas, telemetry, pruning);
+        cfrPruned(history, deal, 1, sampling, 1.0, 1.0, deltas, telemetry, pruning);
+        return util;
+    }
+
+    // cfr() updating only `traverser`, whose reach is `reach`. The
+    // traverser's actions of zero probability and regret below m_pruneBelow
+    // are skipped when `sampling` is 0. Otherwise they are walked with their
+    // regret updates, and those below them, weighted by `sampling`: on the
+    // deals that walk the whole tree, the pruning interval, as each such
+    // walk stands for an interval of deals, and 1 within a subtree that is
+    // already weighted. Opponent actions are always walked: the traverser's
+    // strategy sums below them do not depend on the opponent's reach.
+    double cfrPruned(History &history, const Deal &deal, int traverser, long sampling, double reach,
+                     double opponentReach, NodeTable &deltas, Telemetry &telemetry, PruningCounts &pruning) {
+        if (history.isTerminal()) {
+            telemetry.add(Counter::TerminalEvaluations);
+            return history.payoff(deal);
+        }
+        telemetry.add(Counter::NodeVisits);
+        pruning.visits++;
+
+        int player = history.player();
+        int index = history.infoset(deal);
+        const Node &node = m_nodes[index];
+        std::array<double, NUM_ACTIONS> strategy = node.getStrategy();
+        std::array<double, NUM_ACTIONS> util {0.0};
+        std::array<double, NUM_ACTIONS> weight;
+        weight.fill(1.0);
+        double nodeUtil = 0.0;
+        for (int a=0; a<NUM_ACTIONS; a++) {
+            long childSampling = sampling;
+            if (player == traverser && strategy[a] == 0.0 && node.regretSum[a] < m_pruneBelow) {
+                if (sampling == 0) {
+                    weight[a] = 0.0;
+                    pruning.skipped += history.subtreeSize(a);
+                    continue;
+                }
+                weight[a] = sampling;
+                childSampling = 1;
+            }
+            history.push(a);
+            double value;
+            if (player == traverser)
+                value = cfrPruned(history, deal, traverser, childSampling, reach*strategy[a], weight[a]*opponentReach,
+                                  deltas, telemetry, pruning);
+            else
+                value = cfrPruned(history, deal, traverser, sampling, reach, opponentReach*strategy[a], deltas,
+                                  telemetry, pruning);
+            util[a] = childValue(history, player, value);
+            history.pop();
+            nodeUtil += strategy[a] * util[a];
+        }
+        if (player != traverser)
+            return nodeUtil;
+
+        Node &delta = deltas[index];
+        for (int a=0; a<NUM_ACTIONS; a++) {
+            delta.strategySum[a] += m_strategyWeight * reach * strategy[a];
+            delta.regretSum[a] += m_regretWeight * weight[a] * opponentReach * (util[a] - nodeUtil);
+        }
+        telemetry.add(Counter::RegretUpdates);
+        return nodeUtil;
+    }
+
+    // Deals `size` hands into `batch`, walks them and adds their weighted
+    // regrets and strategy sums to `deltas`, returning the summed game value
+    double batchIteration(int size, Rng &rng, Deck &deck, History &history, Batch &batch, NodeTable &deltas,
+                          Telemetry &telemetry) {
+        uint64_t mark = telemetry.now();
+        batch.size = size;
+        for (int l=0; l<size; l++) {
+            deck.deal(rng, batch.deals[l]);
+            batch.reach0[0][l] = batch.reach1[0][l] = 1.0;
+        }
+        for (int i=0; i<NUM_INFOSETS; i++) {
+            batch.strategy[i] = m_nodes[i].getStrategy();
+            batch.regrets[i].fill(0.0);
+            batch.strategySums[i].fill(0.0);
+        }
+        mark = telemetry.lap(Phase::Deal, mark);
+
+        cfrBatch(history, batch, telemetry);
+        double util = 0.0;
+        for (int l=0; l<size; l++)
+            util += batch.util[0][l];
+        mark = telemetry.lap(Phase::Traversal, mark);
+
+        for (int i=0; i<NUM_INFOSETS; i++) {
+            for (int a=0; a<NUM_ACTIONS; a++) {
+                deltas[i].regretSum[a] += m_regretWeight * batch.regrets[i][a];
+                deltas[i].strategySum[a] += m_strategyWeight * batch.strategySums[i][a];
+            }
+        }
+        telemetry.lap(Phase::Update, mark);
+        return util;
+    }
+
+    // cfr() for every lane of `batch` at once: walks the public tree below
+    // `history`, leaving each lane's utility for the player to act in
+    // batch.util[depth]. Every loop runs over the lanes, so the recursion
+    // and the history's bookkeeping are paid once per batch.
+    void cfrBatch(History &history, Batch &batch, Telemetry &telemetry) {
+        int size = batch.size, depth = history.depth(), player = history.player();
+        const Deal *deals = batch.deals.data();
+        double *util = batch.util[depth].data();
+        if (history.isTerminal()) {
+            telemetry.add(Counter::TerminalEvaluations, size);
+            for (int l=0; l<size; l++)
+                util[l] = history.payoff(deals[l]);
+            return;
+        }
+        telemetry.add(Counter::NodeVisits, size);
+
+        std::array<int, MAX_BATCH> index;
+        for (int l=0; l<size; l++)
+            index[l] = history.infoset(deals[l]);
+        auto &reach = player == 0 ? batch.reach0 : batch.reach1;
+        auto &opponentReach = player == 0 ? batch.reach1 : batch.reach0;
+        for (int l=0; l<size; l++)
+            for (int a=0; a<NUM_ACTIONS; a++)
+                batch.strategySums[index[l]][a] += reach[depth][l] * batch.strategy[index[l]][a];
+        for (int a=0; a<NUM_ACTIONS; a++) {
+            for (int l=0; l<size; l++) {
+                reach[depth+1][l] = reach[depth][l] * batch.strategy[index[l]][a];
+                opponentReach[depth+1][l] = opponentReach[depth][l];
+            }
+            history.push(a);
+            cfrBatch(history, batch, telemetry);
+            double sign = history.player() == player ? 1.0 : -1.0;
+            history.pop();
+            for (int l=0; l<size; l++)
+                batch.actionUtil[depth][a][l] = sign * batch.util[depth+1][l];
+        }
+
+        for (int l=0; l<size; l++) {
+            const std::array<double, NUM_ACTIONS> &strategy = batch.strategy[index[l]];
+            double nodeUtil = 0.0;
+            for (int a=0; a<NUM_ACTIONS; a++)
+                nodeUtil += strategy[a] * batch.actionUtil[depth][a][l];
+            util[l] = nodeUtil;
+            for (int a=0; a<NUM_ACTIONS; a++)
+                batch.regrets[index[l]][a] += opponentReach[depth][l] * (batch.actionUtil[depth][a][l] - nodeUtil);
+        }
+        telemetry.add(Counter::RegretUpdates, size);
+    }
+};
+
+// Trains a fresh Trainer for `iterations` deals unbatched and then in
+// batches of 1, 2, 4, ... MAX_BATCH, printing as CSV the iterations/second,
+// the speedup over the unbatched run, the average game value and the
+// exploitability reached. Larger batches walk the tree less often but use
+// older strategies, so they can need more iterations to converge.
+template <typename Trainer>
+void reportBatchScaling(long iterations) {
+    using Clock = std::chrono::steady_clock;
+    std::vector<int> sizes {0};
+    for (int size=1; size<=Trainer::MAX_BATCH; size*=2)
+        sizes.push_back(size);
+
+    double unbatchedRate = 0.0;
+    std::cout << "batch,iterations_per_second,speedup,game_value,exploitability_mbb\n";
+    for (int size : sizes) {
+        Trainer trainer;
+        if (size > 0)
+            trainer.setBatchSize(size);
+        auto start = Clock::now();
+        double value = trainer.iterate(iterations) / iterations;
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        double rate = iterations / seconds;
+        if (size == 0)
+            unbatchedRate = rate;
+        std::cout << (size == 0 ? "unbatched" : std::to_string(size)) << "," << rate << "," << rate/unbatchedRate
+                  << "," << value << "," << 1000*trainer.exploitability() << "\n";
+    }
+}
+
+// PokerCFR<Game, Policy> as a template of the policy alone
+template <typename Game>
+struct PokerTrainer {
+    template <typename Policy>
+    using Trainer = PokerCFR<Game, Policy>;
+};
+
+// The command line of a poker trainer for Game: trains PokerCFR<Game,
+// Policy> as the options say, or runs one of its reports
+template <typename Game>
+void runPokerTrainer(const Options &options) {
+    long iterations = options.getInt("iterations", Game::ITERATIONS);
+    int threads = options.getInt("threads", 0);
+    long syncInterval = options.getInt("sync-interval", 1000);
+
+    if (options.has("query-benchmark")) {
+        // serve the strategy of a checkpoint, or else of a fresh training run
+        StrategyTable table = options.has("strategy")
+                              ? PokerCFR<Game>::loadStrategyTable(options.getString("strategy", ""))
+                              : [&] {
+                                    PokerCFR<Game> trainer;
+                                    trainer.iterate(iterations);
+                                    return trainer.freeze();
+                                }();
+        reportQueryLatency(table, options.getInt("queries", 1000000),
+                           options.getInt("max-threads", std::max(1u, std::thread::hardware_concurrency())));
+        return;
+    }
+    if (options.has("strategy")) {
+        PokerCFR<Game>::printCheckpointStrategy(options.getString("strategy", ""));
+        return;
+    }
+    if (options.has("compare-policies")) {
+        reportPolicyComparison<PokerTrainer<Game>::template Trainer>(options.getDouble("target-exploitability", 1.0),
+                                                                     options.getInt("max-iterations", 10000000));
+        return;
+    }
+
+    withPolicy(options.getString("policy", VanillaCFR::NAME), [&](auto policy) {
+        typedef PokerCFR<Game, decltype(policy)> Trainer;
+        if (options.has("convergence")) {
+            reportConvergence<Trainer>(options.getDouble("seconds", 5.0));
+            return;
+        }
+        if (options.has("scaling")) {
+            int maxThreads = options.getInt("max-threads", std::max(1u, std::thread::hardware_concurrency()));
+            reportScaling<Trainer>(iterations, syncInterval, maxThreads, ScalingCheck::GameValue,
+                                   options.getDouble("tolerance", 0.005));
+            return;
+        }
+        if (options.has("batch-scaling")) {
+            reportBatchScaling<Trainer>(iterations);
+            return;
+        }
+        if (options.has("distributed-scaling")) {
+            int maxProcesses = options.getInt("max-processes", std::max(1u, std::thread::hardware_concurrency()));
+            reportDistributedScaling<Trainer>(iterations, syncInterval, maxProcesses,
+                                              options.getString("cluster", "/tmp/cfr-" + std::to_string(getpid())
+                                                                           + ".sock"));
+            return;
+        }
+        if (options.has("compare-pruning")) {
+            reportPruning<Trainer>(options.getDouble("target-exploitability", 1.0),
+                                   options.getInt("max-iterations", 10000000), options.getInt("prune-interval", 100));
+            return;
+        }
+
+        auto setUp = [&](Trainer &trainer) {
+            if (options.has("seed"))
+                trainer.setSeed(options.getInt("seed", 0));
+            if (options.has("vector"))
+                trainer.setVectorMode();
+            else if (threads > 0)
+                trainer.setThreads(threads, syncInterval);
+            if (options.has("prune-interval"))
+                trainer.setPruning(options.getInt("prune-interval", 100));
+            if (options.has("batch"))
+                trainer.setBatchSize(options.getInt("batch", 1));
+        };
+        if (options.has("bench")) {
+            Trainer trainer, timed;
+            setUp(trainer);
+            setUp(timed);
+            reportBenchmark(trainer, timed, iterations, options.getDouble("seconds", 1.0),
+                            trainer.nodesPerIteration(), trainer.nodeBytes(), 1000.0);
+            return;
+        }
+
+        Trainer trainer;
+        setUp(trainer);
+        // one process of a cluster, the coordinator being rank 0
+        std::unique_ptr<Cluster> cluster;
+        if (options.has("cluster")) {
+            if (options.has("vector"))
+                throw std::runtime_error("vector training cannot be distributed");
+            cluster.reset(new Cluster(options.getString("cluster", ""), options.getInt("rank", 0),
+                                      options.getInt("processes", 1)));
+            trainer.setCluster(*cluster, syncInterval);
+        }
+        if (options.has("resume"))
+            trainer.loadCheckpoint(options.getString("resume", ""));
+        if (options.has("checkpoint"))
+            trainer.setCheckpoint(options.getString("checkpoint", ""),
+                                  options.getInt("checkpoint-interval", Game::ITERATIONS / 10));
+        if (options.has("eval-interval"))
+            trainer.setEvaluation(options.getInt("eval-interval", 0), options.getDouble("target-exploitability", 0.0),
+                                  options.getString("eval-log", ""));
+        if (options.has("telemetry-log") || options.has("telemetry-status"))
+            trainer.setTelemetry(options.getString("telemetry-log", ""), options.getString("telemetry-status", ""),
+                                 options.getDouble("telemetry-interval", 10.0));
+        trainer.train(iterations);
+    });
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <chrono>
+#include <iostream>
+#include <algorithm>
+#include <string>
+
+// Regret-based pruning for the chance-sampled poker trainers. Once an
+// action's regret is so negative that it could not turn positive within
+// PRUNE_MARGIN pruning intervals even if every iteration raised it by the
+// most one can, regret matching gives it no probability until then, and
+// walking its subtree only refines regrets below a branch that is not
+// played. Pruning skips such subtrees on all but every interval-th deal,
+// which walks the whole tree and weights their regret updates by the
+// interval, so that the pruned branches' regrets still follow the game.
+// The margin is several intervals because one such weighted update can
+// move a regret by an interval's worth of iterations.
+//
+// Pruning needs one walk per player: in a walk that updates both players,
+// the opponent's strategy sums below a skipped action would be lost. A walk
+// for one player only adds to that player's strategy sums, weighted by its
+// own reach, which is zero below its pruned actions, so the average
+// strategy is the one unpruned training with alternating walks would have.
+
+static const int PRUNE_MARGIN = 10;
+
+// Decision points a trainer visited and skipped
+struct PruningCounts {
+    long visits = 0, skipped = 0;
+
+    double skippedFraction() const {
+        return visits + skipped > 0 ? skipped / (double)(visits + skipped) : 0.0;
+    }
+
+    // adds `other` into these counts and clears it
+    void merge(PruningCounts &other) {
+        visits += other.visits;
+        skipped += other.skipped;
+        other = PruningCounts();
+    }
+};
+
+// Trains a fresh Trainer with simultaneous walks, with alternating walks
+// and with alternating walks pruned every `interval` deals until the
+// exploitability of its average strategy is below `target` mbb/g, or for
+// at most maxIterations iterations, printing as CSV how many iterations
+// and seconds that took, the fraction of decision points pruning skipped
+// and the speedup in time to the target over simultaneous walks.
+// Exploitability is checked after batches of 2% of the iterations so far.
+// Trainer needs setPruning(interval), where an interval of 1 never prunes,
+// iterate(n), exploitability() and pruningCounts().
+template <typename Trainer>
+void reportPruning(double target, long maxIterations, long interval) {
+    using Clock = std::chrono::steady_clock;
+    std::cout << "method,iterations,seconds,exploitability_mbb,reached_target,skipped_fraction,speedup\n";
+    double baseline = 0.0;
+    for (const char *method : {"simultaneous", "alternating", "pruned"}) {
+        Trainer trainer;
+        if (method != std::string("simultaneous"))
+            trainer.setPruning(method == std::string("pruned") ? interval : 1);
+        long iterations = 0;
+        double elapsed = 0.0, exploitability = 0.0;
+        while (iterations < maxIterations) {
+            long batch = std::min(maxIterations - iterations, std::max(1L, iterations / 50));
+            auto start = Clock::now();
+            trainer.iterate(batch);
+            elapsed += std::chrono::duration<double>(Clock::now() - start).count();
+            iterations += batch;
+            exploitability = 1000*trainer.exploitability();
+            if (exploitability < target)
+                break;
+        }
+        if (baseline == 0.0)
+            baseline = elapsed;
+        std::cout << method << "," << iterations << "," << elapsed << "," << exploitability << ","
+                  << (exploitability < target ? "yes" : "no") << "," << trainer.pruningCounts().skippedFraction()
+                  << "," << baseline / elapsed << "\n";
+    }
+}
@@ -0,0 +1,169 @@
+#pragma once
+#include <array>
+#include <cstddef>
+
+// Betting-tree helpers shared by the poker trainers. A betting history is
+// identified by its position in the betting trie: the root is 0 and the
+// child reached by action a from position pos is NUM_ACTIONS*pos + 1 + a,
+// so positions can be tracked incrementally while walking the tree.
+
+// Payoff of a terminal trie position for the player to act there:
+// foldPayoff + showdownStake * showdown[player hand][opponent hand].
+struct Terminal {
+    bool terminal;
+    int foldPayoff;
+    int showdownStake;
+};
+
+// Trie position -> index into `histories`, or -1 for positions that are not
+// listed. Histories are spelled with one character per action, the
+// character of action a being actionNames[a].
+template <int NUM_ACTIONS, int MAX_POSITION, std::size_t NUM_HISTORIES>
+constexpr std::array<int, MAX_POSITION> makeHistoryIds(const std::array<const char *, NUM_HISTORIES> &histories,
+                                                       const char *actionNames) {
+    std::array<int, MAX_POSITION> ids {};
+    for (int &id : ids)
+        id = -1;
+    for (std::size_t h=0; h<NUM_HISTORIES; h++) {
+        int pos = 0;
+        for (const char *c = histories[h]; *c; c++) {
+            int action = 0;
+            while (actionNames[action] != *c)
+                action++;
+            pos = NUM_ACTIONS*pos + 1 + action;
+        }
+        ids[pos] = h;
+    }
+    return ids;
+}
+
+// Terminal payoffs of every trie position for bet-level betting. Action a
+// raises the actor's total commitment to stakes[a], stakes[0] being the
+// ante. After the first turn an action at or below the current level ends
+// the hand: matching it calls to showdown, going below it folds, forfeiting
+// what the folder has put in so far.
+template <int NUM_ACTIONS, int NUM_POSITIONS>
+constexpr std::array<Terminal, NUM_POSITIONS> makeBetLevelTerminals(const std::array<int, NUM_ACTIONS> &stakes) {
+    std::array<Terminal, NUM_POSITIONS> terminals {};
+    std::array<bool, NUM_POSITIONS> reachable {};
+    std::array<int, NUM_POSITIONS> depths {}, levels {};
+    std::array<std::array<int, 2>, NUM_POSITIONS> committed {};
+    reachable[0] = true;
+    committed[0] = {stakes[0], stakes[0]};
+    // children always have higher positions than their parents
+    for (int pos=0; NUM_ACTIONS*pos + NUM_ACTIONS < NUM_POSITIONS; pos++) {
+        if (!reachable[pos] || terminals[pos].terminal)
+            continue;
+        int player = depths[pos] % 2;
+        for (int a=0; a<NUM_ACTIONS; a++) {
+            int child = NUM_ACTIONS*pos + 1 + a;
+            reachable[child] = true;
+            depths[child] = depths[pos] + 1;
+            if (depths[pos] > 0 && a <= levels[pos]) {
+                terminals[child].terminal = true;
+                if (a == levels[pos])
+                    terminals[child].showdownStake = stakes[a];
+                else
+                    terminals[child].foldPayoff = committed[pos][player];
+            } else {
+                levels[child] = a > levels[pos] ? a : levels[pos];
+                committed[child] = committed[pos];
+                committed[child][player] = stakes[a];
+            }
+        }
+    }
+    return terminals;
+}
+
+// Largest payoff of any terminal, so that one iteration changes a regret by
+// at most twice this times the opponent's reach
+template <std::size_t NUM_POSITIONS>
+constexpr int maxPayoff(const std::array<Terminal, NUM_POSITIONS> &terminals) {
+    int payoff = 0;
+    for (const Terminal &t : terminals) {
+        if (t.foldPayoff > payoff)
+            payoff = t.foldPayoff;
+        if (t.showdownStake > payoff)
+            payoff = t.showdownStake;
+    }
+    return payoff;
+}
+
+// Number of decision points in the subtree of every trie position, the
+// position itself included, 0 for terminal and unreachable positions
+template <int NUM_ACTIONS, int NUM_POSITIONS>
+constexpr std::array<int, NUM_POSITIONS> makeSubtreeSizes(const std::array<Terminal, NUM_POSITIONS> &terminals) {
+    std::array<int, NUM_POSITIONS> sizes {};
+    std::array<bool, NUM_POSITIONS> decision {};
+    decision[0] = true;
+    for (int pos=0; NUM_ACTIONS*pos + NUM_ACTIONS < NUM_POSITIONS; pos++)
+        if (decision[pos])
+            for (int a=0; a<NUM_ACTIONS; a++)
+                decision[NUM_ACTIONS*pos + 1 + a] = !terminals[NUM_ACTIONS*pos + 1 + a].terminal;
+    // children always have higher positions than their parents
+    for (int pos=NUM_POSITIONS-1; pos>=0; pos--) {
+        if (!decision[pos])
+            continue;
+        sizes[pos] = 1;
+        for (int a=0; a<NUM_ACTIONS && NUM_ACTIONS*pos + 1 + a < NUM_POSITIONS; a++)
+            sizes[pos] += sizes[NUM_ACTIONS*pos + 1 + a];
+    }
+    return sizes;
+}
+
+// The public history of a bet-level betting tree (see makeBetLevelTerminals)
+// for a poker trainer, as the trie position of every depth, from which the
+// terminal status and payoff are looked up. Game gives NUM_ACTIONS,
+// NUM_HANDS, HISTORY_IDS, TERMINALS, SHOWDOWN and SUBTREE_SIZES (see
+// makeSubtreeSizes), and its Deal the hand index of each player. Each
+// (hand, history) pair is one information set, stored at index
+// historyId*NUM_HANDS + hand of the node table, so walking the tree never
+// builds a history string.
+template <typename Game, int DEPTH>
+class BetLevelHistory {
+public:
+    static const int MAX_DEPTH = DEPTH;
+
+    void push(int action) {
+        m_depth++;
+        m_positions[m_depth] = Game::NUM_ACTIONS*m_positions[m_depth-1] + 1 + action;
+    }
+
+    void pop() {
+        m_depth--;
+    }
+
+    int depth() const {
+        return m_depth;
+    }
+
+    // player 1 for even depths, player 2 for odd
+    int player() const {
+        return m_depth % 2;
+    }
+
+    bool isTerminal() const {
+        return Game::TERMINALS[m_positions[m_depth]].terminal;
+    }
+
+    // payoff of a terminal history for the player to act
+    template <typename Deal>
+    double payoff(const Deal &deal) const {
+        const Terminal &t = Game::TERMINALS[m_positions[m_depth]];
+        int player = m_depth % 2;
+        return t.foldPayoff + t.showdownStake*Game::SHOWDOWN[deal.hands[player]][deal.hands[1-player]];
+    }
+
+    template <typename Deal>
+    int infoset(const Deal &deal) const {
+        return Game::HISTORY_IDS[m_positions[m_depth]]*Game::NUM_HANDS + deal.hands[m_depth % 2];
+    }
+
+    int subtreeSize(int action) const {
+        return Game::SUBTREE_SIZES[Game::NUM_ACTIONS*m_positions[m_depth] + 1 + action];
+    }
+
+private:
+    int m_depth = 0;
+    std::array<int, MAX_DEPTH+1> m_positions {0};
+};
@@ -0,0 +1,118 @@
+#pragma once
+#include <cmath>
+#include <string>
+#include <cstdint>
+#include <stdexcept>
+
+// Regret-update rules for the CFR trainers, chosen at compile time through a
+// template parameter so that no per-node call goes through a virtual. Each
+// policy gives the weights of iteration t's regret and strategy-sum updates
+// (t counts from 1) and endIteration(node, t), which a trainer applies to
+// every node at the end of iteration t when TABLE_PASS is set. ALTERNATING
+// policies update one player per tree walk, the second walk seeing the
+// first player's new regrets.
+//
+// Nodes need regretSum and strategySum arrays.
+
+// plain regret matching with uniform averaging
+struct VanillaCFR {
+    static const uint32_t ID = 0;
+    static constexpr const char *NAME = "vanilla";
+    static const bool ALTERNATING = false, TABLE_PASS = false;
+
+    static double regretWeight(long) { return 1.0; }
+    static double strategyWeight(long) { return 1.0; }
+
+    template <typename Node>
+    static void endIteration(Node &, long) {}
+};
+
+// CFR+: regrets floored at zero after every iteration, alternating updates
+// and an average strategy weighted by iteration
+struct CFRPlus {
+    static const uint32_t ID = 1;
+    static constexpr const char *NAME = "cfr+";
+    static const bool ALTERNATING = true, TABLE_PASS = true;
+
+    static double regretWeight(long) { return 1.0; }
+    static double strategyWeight(long t) { return t; }
+
+    template <typename Node>
+    static void endIteration(Node &node, long) {
+        for (auto &regret : node.regretSum)
+            if (regret < 0)
+                regret = 0;
+    }
+};
+
+// Linear CFR: regrets and strategies both weighted by iteration. Rather
+// than adding iteration t's updates with weight t, which outgrows 32-bit
+// fixed-point regrets within a million iterations, both sums are scaled by
+// t/(t + 1) after iteration t, so they hold the linearly weighted sums over
+// t + 1 and every update keeps weight 1. Regret matching and averaging are
+// unchanged by the common factor.
+struct LinearCFR {
+    static const uint32_t ID = 2;
+    static constexpr const char *NAME = "linear";
+    static const bool ALTERNATING = false, TABLE_PASS = true;
+
+    static double regretWeight(long) { return 1.0; }
+    static double strategyWeight(long) { return 1.0; }
+
+    template <typename Node>
+    static void endIteration(Node &node, long t) {
+        double discount = t / (t + 1.0);
+        for (auto &regret : node.regretSum)
+            regret *= discount;
+        for (auto &sum : node.strategySum)
+            sum *= discount;
+    }
+};
+
+// Discounted CFR with alpha = 3/2, beta = 0 and gamma = 2: after iteration
+// t positive regrets are scaled by t^a/(t^a + 1), negative regrets by
+// t^b/(t^b + 1) and strategy sums by (t/(t + 1))^g
+struct DiscountedCFR {
+    static const uint32_t ID = 3;
+    static constexpr const char *NAME = "dcfr";
+    static const bool ALTERNATING = false, TABLE_PASS = true;
+
+    static double regretWeight(long) { return 1.0; }
+    static double strategyWeight(long) { return 1.0; }
+
+    template <typename Node>
+    static void endIteration(Node &node, long t) {
+        double positive = std::pow(t, 1.5), strategy = t / (t + 1.0);
+        positive /= positive + 1;
+        strategy *= strategy;
+        for (auto &regret : node.regretSum)
+            regret *= regret > 0 ? positive : 0.5;
+        for (auto &sum : node.strategySum)
+            sum *= strategy;
+    }
+};
+
+// Calls f with a default-constructed value of the policy called `name`, so
+// that a generic lambda can instantiate a trainer for it
+template <typename F>
+void withPolicy(const std::string &name, F f) {
+    if (name == VanillaCFR::NAME)
+        f(VanillaCFR());
+    else if (name == CFRPlus::NAME)
+        f(CFRPlus());
+    else if (name == LinearCFR::NAME)
+        f(LinearCFR());
+    else if (name == DiscountedCFR::NAME)
+        f(DiscountedCFR());
+    else
+        throw std::runtime_error("unknown policy " + name + " (vanilla, cfr+, linear or dcfr)");
+}
+
+// Calls f once for every policy, in the order above
+template <typename F>
+void forEachPolicy(F f) {
+    f(VanillaCFR());
+    f(CFRPlus());
+    f(LinearCFR());
+    f(DiscountedCFR());
+}
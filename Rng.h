@@ -0,0 +1,152 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <utility>
+
+// Random numbers for the trainers.
+//
+// Rng is xoshiro256** (Blackman and Vigna): four words of state, a few
+// shifts, rotates and multiplies per 64 random bits, and no global state,
+// so every trainer and worker thread owns its generator. Rng(seed, stream)
+// gives independent streams of one seed for worker threads: stream s
+// starts 2^128 numbers after stream s-1, so streams never overlap and a
+// run is reproducible for a given seed and thread count.
+class Rng {
+public:
+    typedef uint64_t result_type;
+
+    explicit Rng(uint64_t seed = 0, int stream = 0) {
+        this->seed(seed, stream);
+    }
+
+    void seed(uint64_t seed, int stream = 0) {
+        // expand the seed with splitmix64, as the authors recommend
+        for (uint64_t &word : m_state) {
+            uint64_t z = (seed += 0x9e3779b97f4a7c15);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+            word = z ^ (z >> 31);
+        }
+        for (int s=0; s<stream; s++)
+            jump();
+    }
+
+    static constexpr uint64_t min() {
+        return 0;
+    }
+
+    static constexpr uint64_t max() {
+        return UINT64_MAX;
+    }
+
+    uint64_t operator()() {
+        uint64_t result = rotl(m_state[1] * 5, 7) * 9;
+        uint64_t t = m_state[1] << 17;
+        m_state[2] ^= m_state[0];
+        m_state[3] ^= m_state[1];
+        m_state[1] ^= m_state[2];
+        m_state[0] ^= m_state[3];
+        m_state[2] ^= t;
+        m_state[3] = rotl(m_state[3], 45);
+        return result;
+    }
+
+    // uniform in [0, 1), from the top 53 bits
+    double uniform() {
+        return ((*this)() >> 11) * 0x1.0p-53;
+    }
+
+    // uniform in [0, n), by Lemire's multiply-and-shift with rejection of
+    // the few products that would bias it
+    uint32_t below(uint32_t n) {
+        uint64_t m = ((*this)() >> 32) * n;
+        uint32_t low = m;
+        if (low < n) {
+            uint32_t threshold = -n % n;
+            while (low < threshold) {
+                m = ((*this)() >> 32) * n;
+                low = m;
+            }
+        }
+        return m >> 32;
+    }
+
+    // advance 2^128 numbers
+    void jump() {
+        static const uint64_t JUMP[] = {0x180ec6d33cfd0aba, 0xd5a61266f0c9392c, 0xa9582618e03fc9aa, 0x39abdc4529b1661c};
+        uint64_t state[4] = {0, 0, 0, 0};
+        for (uint64_t word : JUMP) {
+            for (int bit=0; bit<64; bit++) {
+                if (word & (uint64_t)1 << bit)
+                    for (int i=0; i<4; i++)
+                        state[i] ^= m_state[i];
+                (*this)();
+            }
+        }
+        for (int i=0; i<4; i++)
+            m_state[i] = state[i];
+    }
+
+private:
+    uint64_t m_state[4];
+
+    static uint64_t rotl(uint64_t x, int k) {
+        return (x << k) | (x >> (64 - k));
+    }
+};
+
+// Moves a uniform random choice of k of the n items at `items` to the
+// front, in random order, with the first k steps of a Fisher-Yates shuffle.
+// Dealing k cards costs k draws however big the deck is.
+template <typename T>
+void partialShuffle(T *items, size_t n, size_t k, Rng &rng) {
+    for (size_t i=0; i<k; i++)
+        std::swap(items[i], items[i + rng.below(n - i)]);
+}
+
+// Samples from a fixed distribution over n outcomes in constant time, with
+// Vose's alias method: outcome i keeps probability probability[i] of its
+// slot and gives the rest to alias[i]. Building costs O(n), so it pays when
+// a distribution is sampled many times, e.g. a strategy that stays fixed
+// for a round of parallel training.
+class AliasTable {
+public:
+    // Rebuilds the table for the n probabilities at p, which sum to 1,
+    // reusing its storage
+    void build(const double *p, int n) {
+        m_probability.resize(n);
+        m_alias.resize(n);
+        m_small.clear();
+        m_large.clear();
+        for (int i=0; i<n; i++) {
+            m_probability[i] = p[i] * n;
+            (m_probability[i] < 1 ? m_small : m_large).push_back(i);
+        }
+        while (!m_small.empty() && !m_large.empty()) {
+            int small = m_small.back(), large = m_large.back();
+            m_small.pop_back();
+            m_alias[small] = large;
+            m_probability[large] = (m_probability[large] + m_probability[small]) - 1;
+            if (m_probability[large] < 1) {
+                m_large.pop_back();
+                m_small.push_back(large);
+            }
+        }
+        // what is left is 1 up to rounding
+        for (int i : m_small)
+            m_probability[i] = 1;
+        for (int i : m_large)
+            m_probability[i] = 1;
+    }
+
+    int sample(Rng &rng) const {
+        int i = rng.below(m_probability.size());
+        return rng.uniform() < m_probability[i] ? i : m_alias[i];
+    }
+
+private:
+    std::vector<double> m_probability;
+    std::vector<int> m_alias;
+    std::vector<int> m_small, m_large;
+};
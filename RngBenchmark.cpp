@@ -0,0 +1,90 @@
+#include <iostream>
+#include <random>
+#include <array>
+#include <vector>
+#include <chrono>
+#include <numeric>
+#include <algorithm>
+#include "Options.h"
+#include "Rng.h"
+
+// Samples per second of the trainers' random numbers before and after
+// Rng.h, printed as CSV: uniform doubles, deals of 4 of the 16 two-card
+// Kuhn cards, and actions drawn from fixed strategies of Blotto's sizes.
+
+using Clock = std::chrono::steady_clock;
+
+// sink for results, so that the compiler cannot drop the work
+static volatile long g_sink;
+
+template <typename F>
+void measure(const char *benchmark, const char *method, long samples, F sample) {
+    long checksum = 0;
+    auto start = Clock::now();
+    for (long i=0; i<samples; i++)
+        checksum += sample();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    g_sink = checksum;
+    std::cout << benchmark << "," << method << "," << samples / seconds << "\n";
+}
+
+int main(int argc, char **argv) {
+    Options options(argc, argv);
+    long samples = options.getInt("samples", 10000000);
+
+    std::cout << "benchmark,method,samples_per_second\n";
+
+    std::mt19937 mt(9);
+    Rng rng(9);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    measure("uniform", "rand", samples, [] { return (long)(1e6 * ((double)rand()/RAND_MAX)); });
+    measure("uniform", "mt19937", samples, [&] { return (long)(1e6 * uniform(mt)); });
+    measure("uniform", "xoshiro256**", samples, [&] { return (long)(1e6 * rng.uniform()); });
+
+    std::array<int, 16> deck {1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4};
+    auto dealt = [&] { return deck[0] + 4*deck[1] + 16*deck[2] + 64*deck[3]; };
+    measure("deal 4 of 16", "random_shuffle", samples, [&] {
+        std::random_shuffle(deck.begin(), deck.end());
+        return dealt();
+    });
+    measure("deal 4 of 16", "shuffle mt19937", samples, [&] {
+        std::shuffle(deck.begin(), deck.end(), mt);
+        return dealt();
+    });
+    measure("deal 4 of 16", "partial Fisher-Yates", samples, [&] {
+        partialShuffle(deck.data(), deck.size(), 4, rng);
+        return dealt();
+    });
+
+    // action counts of 5 and 10 soldiers over 3 and 5 battlefields
+    for (int n : {21, 1001, 10000}) {
+        std::vector<double> strategy(n), cumulative(n);
+        for (int a=0; a<n; a++)
+            strategy[a] = 1 + rng.below(100);
+        double total = std::accumulate(strategy.begin(), strategy.end(), 0.0);
+        for (double &p : strategy)
+            p /= total;
+        std::partial_sum(strategy.begin(), strategy.end(), cumulative.begin());
+        AliasTable alias;
+        alias.build(strategy.data(), n);
+        std::string name = "action of " + std::to_string(n);
+        long actionSamples = std::max(1L, samples * 21 / n);
+        measure(name.c_str(), "linear scan", actionSamples, [&] {
+            double r = (double)rand()/RAND_MAX, cumulativeProb = 0.0;
+            int a = 0;
+            while (a < n - 1) {
+                cumulativeProb += strategy[a];
+                if (r < cumulativeProb)
+                    break;
+                a++;
+            }
+            return a;
+        });
+        measure(name.c_str(), "binary search", samples, [&] {
+            int a = std::upper_bound(cumulative.begin(), cumulative.end(), rng.uniform()) - cumulative.begin();
+            return std::min(a, n - 1);
+        });
+        measure(name.c_str(), "alias table", samples, [&] { return alias.sample(rng); });
+    }
+    return 0;
+}
@@ -1,137 +1,96 @@
 #include <iostream>
-#include <random>
-#include <array>
+#include <vector>
+#include "Options.h"
+#include "NormalFormGame.h"
+#include "Benchmark.h"
 
-class RockPaperScissorsCFR {
+// Rock paper scissors, as a payoff matrix for the normal-form engine
+class RockPaperScissorsCFR : public NormalFormCFR<int8_t> {
 
 public:
     static const int ROCK = 0, PAPER = 1, SCISSORS = 2;
     static const int NUM_ACTIONS = 3;
 
-    std::array<double, NUM_ACTIONS> m_regretSum {0};
-    std::array<double, NUM_ACTIONS> m_strategySum {0};
-    std::array<double, NUM_ACTIONS> m_oppRegretSum {0};
-    std::array<double, NUM_ACTIONS> m_oppStrategySum {0};
+    RockPaperScissorsCFR()
+        : NormalFormCFR(PayoffMatrix<int8_t>::generate(NUM_ACTIONS, NUM_ACTIONS, utility),
+                        GameId::RockPaperScissors) {}
 
-    RockPaperScissorsCFR() {
-        std::cout << "Initialising RockPaperScissorsCFR instance\n";
+    // payoff of playing `action` against `oppAction`
+    static int utility(int action, int oppAction) {
+        if (action == oppAction)
+            return 0;
+        return (action - oppAction + NUM_ACTIONS) % NUM_ACTIONS == 1 ? 1 : -1;
     }
+};
 
-    int getAction(std::array<double, NUM_ACTIONS> strategy) {
-        double r = (double)rand()/RAND_MAX;
-        int a = 0;
-        double cumulativeProbability = 0.0;
-        while (a < NUM_ACTIONS - 1) {
-            cumulativeProbability += strategy[a];
-            if (r < cumulativeProbability)
-                break;
-            a++;
-        }
-        return a;
-    }
-
-    void train(int iterations) {
-        std::array<double, NUM_ACTIONS> actionUtility {0};
-        for (int i = 0; i < iterations; i++) {
-            std::array<double, NUM_ACTIONS> myStrategy = getStrategy(m_regretSum);
-            std::array<double, NUM_ACTIONS> oppStrategy = getStrategy(m_oppRegretSum);
-            int myAction = getAction(myStrategy);
-            int oppAction = getAction(oppStrategy);
-
-            actionUtility[oppAction] = 0; // doing the same as opp. has value 0
-            switch (oppAction) {
-                case ROCK:
-                    actionUtility[PAPER] = 1;
-                    actionUtility[SCISSORS] = -1;
-                    break;
-                case PAPER:
-                    actionUtility[SCISSORS] = 1;
-                    actionUtility[ROCK] = -1;
-                    break;
-                case SCISSORS:
-                    actionUtility[ROCK] = 1;
-                    actionUtility[PAPER] = -1;
-                    break;
-            }
-
-            for (int a=0; a<NUM_ACTIONS; ++a) {
-                m_regretSum[a] += actionUtility[a] - actionUtility[myAction];
-                m_strategySum[a] += myStrategy[a];
-            }
 
-            actionUtility[myAction] = 0; // doing the same as opp. has value 0
-            switch (myAction) {
-                case ROCK:
-                    actionUtility[PAPER] = 1;
-                    actionUtility[SCISSORS] = -1;
-                    break;
-                case PAPER:
-                    actionUtility[SCISSORS] = 1;
-                    actionUtility[ROCK] = -1;
-                    break;
-                case SCISSORS:
-                    actionUtility[ROCK] = 1;
-                    actionUtility[PAPER] = -1;
-                    break;
-            }
+int main(int argc, char **argv) {
+    Options options(argc, argv);
+    try {
+        long iterations = options.getInt("iterations", 10000000);
+        int threads = options.getInt("threads", 0);
+        long syncInterval = options.getInt("sync-interval", 10000);
 
-            for (int a=0; a<NUM_ACTIONS; ++a) {
-                m_oppRegretSum[a] += actionUtility[a] - actionUtility[oppAction];
-                m_oppStrategySum[a] += oppStrategy[a];
-            }
+        if (options.has("scaling")) {
+            int maxThreads = options.getInt("max-threads", std::max(1u, std::thread::hardware_concurrency()));
+            reportScaling<RockPaperScissorsCFR>(iterations, syncInterval, maxThreads, ScalingCheck::Strategies,
+                                                options.getDouble("tolerance", 0.05));
+            return 0;
         }
-    }
-
-    std::array<double, NUM_ACTIONS> getAverageStrategy() {
-        std::array<double, NUM_ACTIONS> avgStrategy {0};
-        double normalizingSum = 0.0;
-        for (int a=0; a<NUM_ACTIONS; a++) {
-            normalizingSum += m_strategySum[a];
+        if (options.has("write-matrix")) {
+            RockPaperScissorsCFR().matrix().write(options.getString("write-matrix", ""));
+            return 0;
         }
-        for (int a=0; a<NUM_ACTIONS; a++) {
-            if (normalizingSum > 0) {
-                avgStrategy[a] = m_strategySum[a] / normalizingSum;
-            } else {
-                avgStrategy[a] = 1.0 / NUM_ACTIONS;
-            }
+        if (options.has("compare-modes")) {
+            reportFullWidthComparison([] { return RockPaperScissorsCFR(); },
+                                      options.getDouble("target-exploitability", 0.001),
+                                      options.getInt("max-iterations", 10000000));
+            return 0;
         }
-        return avgStrategy;
-    }
-
-private:
 
-    std::array<double, NUM_ACTIONS> getStrategy(std::array<double, NUM_ACTIONS> regretSum) {
-        double normalizingSum = 0.0;
-        std::array<double, NUM_ACTIONS> strategy;
-        for (int a=0; a<NUM_ACTIONS; ++a) {
-            strategy[a] = regretSum[a] > 0 ? regretSum[a] : 0;
-            normalizingSum += strategy[a];
+        auto setUp = [&](RockPaperScissorsCFR &trainer) {
+            if (options.has("seed"))
+                trainer.setSeed(options.getInt("seed", 0));
+            if (options.has("full-width"))
+                trainer.setFullWidthMode(options.has("alternating"));
+            else if (threads > 0)
+                trainer.setThreads(threads, syncInterval);
+        };
+        if (options.has("bench")) {
+            RockPaperScissorsCFR trainer, timed;
+            setUp(trainer);
+            setUp(timed);
+            // an iteration updates one regret table per player
+            reportBenchmark(trainer, timed, iterations, options.getDouble("seconds", 1.0), 2, 0, 1.0);
+            return 0;
         }
-        for (int a=0; a<NUM_ACTIONS; ++a) {
-            if (normalizingSum > 0) {
-                strategy[a] /= normalizingSum;
-            } else {
-                strategy[a] = 1.0 / NUM_ACTIONS;
-            }
-        }
-        return strategy;
-    }
-};
-
 
-int main() {
-    std::cout << "Starting\n";
-
-    RockPaperScissorsCFR cfr_game;
-    cfr_game.train(10000000);
-    auto finalStrategy = cfr_game.getAverageStrategy();
-    std::cout << "Final Strategy: (";
-    for (int a=0; a<finalStrategy.size(); a++) {
-        if (a)
-            std::cout << ", ";
-        std::cout << finalStrategy[a];
+        std::cout << "Starting\n";
+
+        RockPaperScissorsCFR cfr_game;
+        setUp(cfr_game);
+        if (options.has("resume"))
+            cfr_game.loadCheckpoint(options.getString("resume", ""));
+        if (options.has("checkpoint"))
+            cfr_game.setCheckpoint(options.getString("checkpoint", ""),
+                                   options.getInt("checkpoint-interval", 10000000));
+        if (options.has("eval-interval"))
+            cfr_game.setEvaluation(options.getInt("eval-interval", 0), options.getDouble("target-exploitability", 0.0),
+                                   options.getString("eval-log", ""));
+        cfr_game.train(iterations);
+        auto finalStrategy = cfr_game.getAverageStrategy();
+        std::cout << "Final Strategy: (";
+        for (size_t a=0; a<finalStrategy.size(); a++) {
+            if (a)
+                std::cout << ", ";
+            std::cout << finalStrategy[a];
+        }
+        std::cout << ")\n";
+        std::cout << "Exploitability: " << cfr_game.exploitability() << " per game\n";
+    } catch (const std::exception &e) {
+        std::cerr << "error: " << e.what() << "\n";
+        return 1;
     }
-    std::cout << ")\n";
 
     return 0;    
 }
\ No newline at end of file
@@ -0,0 +1,212 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <thread>
+#include <cstdlib>
+#include <iostream>
+#include <algorithm>
+#include <stdexcept>
+#include "NodeStorage.h"
+#include "Checkpoint.h"
+#include "Rng.h"
+
+// A trained policy frozen for serving: the average strategy of every
+// information set, looked up by the trainer's dense node index. Rows are
+// padded to nodeStride() in one cache-line-aligned block, so a lookup
+// touches a single line, and nothing changes after construction, so any
+// number of threads can query one table without locking. Queries take the
+// caller's random numbers rather than keeping a generator.
+class StrategyTable {
+public:
+    // `strategies` holds numNodes*numActions probabilities, node-major;
+    // names[i] is node i's information set name, for find()
+    StrategyTable(int numNodes, int numActions, const std::vector<double> &strategies,
+                  const std::vector<std::string> &names)
+        : m_numNodes(numNodes), m_numActions(numActions),
+          m_stride(nodeStride(numActions * sizeof(double)) / sizeof(double)) {
+        if ((int)strategies.size() != numNodes * numActions || (int)names.size() != numNodes)
+            throw std::runtime_error("strategy table shape does not match");
+        std::size_t bytes = (numNodes * m_stride * sizeof(double) + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+        void *data = std::aligned_alloc(CACHE_LINE, std::max(bytes, CACHE_LINE));
+        if (!data)
+            throw std::bad_alloc();
+        m_rows.reset(static_cast<double *>(data));
+        for (int i=0; i<numNodes; i++)
+            for (int a=0; a<m_stride; a++)
+                m_rows.get()[i*m_stride + a] = a < numActions ? strategies[i*numActions + a] : 0.0;
+        for (int i=0; i<numNodes; i++)
+            m_names.emplace_back(names[i], i);
+        std::sort(m_names.begin(), m_names.end());
+    }
+
+    // The average strategies stored in a checkpoint, read from the mapped
+    // file once
+    StrategyTable(const MappedCheckpoint &checkpoint, const std::vector<std::string> &names)
+        : StrategyTable(names.size(), checkpoint.header().numActions, averages(checkpoint), names) {}
+
+    int numNodes() const {
+        return m_numNodes;
+    }
+
+    int numActions() const {
+        return m_numActions;
+    }
+
+    // dense index of the named information set, e.g. "2pb", or -1
+    int find(const std::string &name) const {
+        auto it = std::lower_bound(m_names.begin(), m_names.end(), std::make_pair(name, -1));
+        return it != m_names.end() && it->first == name ? it->second : -1;
+    }
+
+    // the numActions() probabilities of node `index`
+    const double *strategy(int index) const {
+        return m_rows.get() + index*m_stride;
+    }
+
+    // The action node `index` plays for `u`, uniform in [0, 1): the first
+    // whose cumulative probability exceeds u
+    int sample(int index, double u) const {
+        const double *p = strategy(index);
+        for (int a=0; a<m_numActions-1; a++) {
+            u -= p[a];
+            if (u < 0)
+                return a;
+        }
+        return m_numActions - 1;
+    }
+
+    int sample(int index, Rng &rng) const {
+        return sample(index, rng.uniform());
+    }
+
+    // Copies the strategies of n nodes to out, numActions() per node
+    void strategies(const int *indices, std::size_t n, double *out) const {
+        for (std::size_t q=0; q<n; q++, out+=m_numActions) {
+            const double *p = strategy(indices[q]);
+            for (int a=0; a<m_numActions; a++)
+                out[a] = p[a];
+        }
+    }
+
+    // samples an action of each of n nodes, one uniform per query
+    void sample(const int *indices, const double *uniforms, std::size_t n, int *actions) const {
+        for (std::size_t q=0; q<n; q++)
+            actions[q] = sample(indices[q], uniforms[q]);
+    }
+
+private:
+    struct Free {
+        void operator()(double *p) const {
+            std::free(p);
+        }
+    };
+
+    const int m_numNodes, m_numActions, m_stride;
+    std::unique_ptr<double, Free> m_rows;
+    std::vector<std::pair<std::string, int>> m_names; // sorted by name
+
+    static std::vector<double> averages(const MappedCheckpoint &checkpoint) {
+        const CheckpointHeader &header = checkpoint.header();
+        std::vector<double> strategies(header.numNodes * header.numActions);
+        for (uint64_t i=0; i<header.numNodes; i++)
+            checkpoint.averageStrategy(i, &strategies[i * header.numActions]);
+        return strategies;
+    }
+};
+
+// Latencies of `calls` calls of query(call), each timed on its own, in
+// nanoseconds less the cost of reading the clock, sorted
+template <typename Query>
+std::vector<double> timeQueries(long calls, Query query) {
+    using Clock = std::chrono::steady_clock;
+    std::vector<double> overheads(std::min(calls, 10000L)), latencies(calls);
+    for (double &overhead : overheads) {
+        auto start = Clock::now();
+        overhead = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    }
+    std::sort(overheads.begin(), overheads.end());
+    double overhead = overheads[overheads.size() / 2];
+    for (long c=0; c<calls; c++) {
+        auto start = Clock::now();
+        query(c);
+        latencies[c] = std::max(0.0, std::chrono::duration<double, std::nano>(Clock::now() - start).count() - overhead);
+    }
+    std::sort(latencies.begin(), latencies.end());
+    return latencies;
+}
+
+// Benchmarks `table` with `queries` random node indices and prints as CSV
+// the median and 99th percentile latency per query and the queries per
+// second, for single strategy lookups and samples and for batches of 16 to
+// 4096 queries, batches running on 1 to `maxThreads` threads sharing the
+// table. Batch latencies are per batch divided by its size. Latencies and
+// throughput are measured in separate passes, so that reading the clock
+// around every call does not count against throughput.
+inline void reportQueryLatency(const StrategyTable &table, long queries, int maxThreads) {
+    using Clock = std::chrono::steady_clock;
+    queries = std::max(queries, 4096L);
+    Rng rng(1);
+    std::vector<int> indices(queries);
+    std::vector<double> uniforms(queries);
+    for (long q=0; q<queries; q++) {
+        indices[q] = rng.below(table.numNodes());
+        uniforms[q] = rng.uniform();
+    }
+
+    std::vector<int> threadCounts;
+    for (int threads=1; threads<maxThreads; threads*=2)
+        threadCounts.push_back(threads);
+    threadCounts.push_back(maxThreads);
+
+    std::cout << "query,batch,threads,p50_ns,p99_ns,queries_per_second\n";
+    for (long batch : {1L, 16L, 256L, 4096L}) {
+        for (int threads : batch == 1 ? std::vector<int> {1} : threadCounts) {
+            for (std::string query : {"strategy", "sample"}) {
+                bool sampling = query == "sample";
+                long batches = queries / batch;
+                std::vector<std::vector<double>> latencies(threads);
+                // runs every batch on each thread, on its own output
+                // buffers, timing each batch or else the whole run
+                auto run = [&](bool timed) {
+                    std::vector<std::thread> workers;
+                    auto start = Clock::now();
+                    for (int t=0; t<threads; t++) {
+                        workers.emplace_back([&, t] {
+                            // results go here so that the queries are not optimised away
+                            volatile double sink = 0.0;
+                            std::vector<double> strategies(batch * table.numActions());
+                            std::vector<int> actions(batch);
+                            auto answer = [&](long b) {
+                                long first = b * batch;
+                                if (sampling)
+                                    table.sample(&indices[first], &uniforms[first], batch, actions.data());
+                                else
+                                    table.strategies(&indices[first], batch, strategies.data());
+                                sink = sink + (sampling ? actions[0] : strategies[0]);
+                            };
+                            if (timed)
+                                latencies[t] = timeQueries(batches, answer);
+                            else
+                                for (long b=0; b<batches; b++)
+                                    answer(b);
+                        });
+                    }
+                    for (std::thread &worker : workers)
+                        worker.join();
+                    return std::chrono::duration<double>(Clock::now() - start).count();
+                };
+                run(true);
+                double seconds = run(false);
+
+                std::vector<double> all;
+                for (std::vector<double> &l : latencies)
+                    all.insert(all.end(), l.begin(), l.end());
+                std::sort(all.begin(), all.end());
+                std::cout << query << "," << batch << "," << threads << "," << all[all.size() / 2] / batch << ","
+                          << all[all.size() * 99 / 100] / batch << "," << batches * batch * threads / seconds << "\n";
+            }
+        }
+    }
+}
@@ -0,0 +1,172 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <stdexcept>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Training telemetry: counts of the work a trainer does and the time it
+// spends in each phase of an iteration, written out periodically while
+// train() runs.
+//
+// Counting costs a few instructions per node, so it is compiled in only
+// with -DCFR_TELEMETRY (make TELEMETRY=1). Without it every add() and lap()
+// is an empty inline function and the counters stay zero.
+#ifdef CFR_TELEMETRY
+static const bool TELEMETRY = true;
+#else
+static const bool TELEMETRY = false;
+#endif
+
+enum class Counter { NodeVisits, NodeCreations, TerminalEvaluations, RegretUpdates };
+enum class Phase { Deal, Traversal, Update };
+static const int NUM_COUNTERS = 4, NUM_PHASES = 3;
+
+// Time stamp counter ticks where there is one, nanoseconds otherwise. The
+// reporter calibrates ticks against the steady clock, so only differences
+// mean anything.
+inline uint64_t readTimestamp() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// The counters of one thread. Each worker owns one and the trainer adds
+// them up when it merges the workers' tables, so counting needs neither
+// atomics nor shared cache lines.
+//
+// Phases are timed as laps: take mark = now() before the first phase, then
+// mark = lap(phase, mark) at the end of each.
+struct Telemetry {
+    std::array<uint64_t, NUM_COUNTERS> counts {0};
+    std::array<uint64_t, NUM_PHASES> ticks {0};
+
+    void add(Counter counter, uint64_t n = 1) {
+        if (TELEMETRY)
+            counts[(int)counter] += n;
+    }
+
+    uint64_t now() const {
+        return TELEMETRY ? readTimestamp() : 0;
+    }
+
+    uint64_t lap(Phase phase, uint64_t mark) {
+        if (!TELEMETRY)
+            return 0;
+        uint64_t time = readTimestamp();
+        ticks[(int)phase] += time - mark;
+        return time;
+    }
+
+    // adds `other` into these counters and clears it
+    void merge(Telemetry &other) {
+        for (int c=0; c<NUM_COUNTERS; c++)
+            counts[c] += other.counts[c];
+        for (int p=0; p<NUM_PHASES; p++)
+            ticks[p] += other.ticks[p];
+        other = Telemetry();
+    }
+};
+
+// Writes a trainer's telemetry every `interval` seconds of train(): one
+// JSON object per line appended to a log, and/or the latest one written to
+// a status file that is replaced by a rename, so that a reader never sees
+// half of it. Reports are written between the batches of train(), by the
+// training thread, and cost one small write; the hot loops only touch their
+// own thread's counters. Without a call to configure() it does nothing.
+class TelemetryReporter {
+public:
+    TelemetryReporter() = default;
+    TelemetryReporter(const TelemetryReporter &) = delete;
+    TelemetryReporter &operator=(const TelemetryReporter &) = delete;
+
+    ~TelemetryReporter() {
+        if (m_log)
+            std::fclose(m_log);
+    }
+
+    // `iterations` is how many the trainer has already run
+    void configure(const std::string &logPath, const std::string &statusPath, double interval, long iterations) {
+        if (interval <= 0)
+            throw std::runtime_error("telemetry interval must be positive");
+        if (!logPath.empty()) {
+            m_log = std::fopen(logPath.c_str(), "a");
+            if (!m_log)
+                throw std::runtime_error("cannot write telemetry log " + logPath);
+        }
+        m_statusPath = statusPath;
+        m_interval = interval;
+        m_start = m_last = Clock::now();
+        m_startTicks = readTimestamp();
+        m_lastIterations = iterations;
+    }
+
+    bool enabled() const {
+        return m_interval > 0;
+    }
+
+    // Reports `totals` if an interval has passed since the last report, or
+    // regardless when `force` is set, as at the end of training
+    void update(long iterations, const Telemetry &totals, bool force = false) {
+        if (!enabled())
+            return;
+        Clock::time_point now = Clock::now();
+        double sinceLast = std::chrono::duration<double>(now - m_last).count();
+        if (!force && sinceLast < m_interval)
+            return;
+        double seconds = std::chrono::duration<double>(now - m_start).count();
+        double ticksPerSecond = seconds > 0 ? (readTimestamp() - m_startTicks) / seconds : 1.0;
+
+        char line[1024];
+        int length = std::snprintf(line, sizeof(line),
+                                   "{\"seconds\": %.3f, \"iterations\": %ld, \"iterations_per_second\": %.6g",
+                                   seconds, iterations,
+                                   sinceLast > 0 ? (iterations - m_lastIterations) / sinceLast : 0.0);
+        if (TELEMETRY) {
+            static const char *COUNTERS[NUM_COUNTERS] = {"node_visits", "node_creations", "terminal_evaluations",
+                                                         "regret_updates"};
+            static const char *PHASES[NUM_PHASES] = {"deal", "traversal", "update"};
+            for (int c=0; c<NUM_COUNTERS; c++)
+                length += std::snprintf(line + length, sizeof(line) - length, ", \"%s\": %llu", COUNTERS[c],
+                                        (unsigned long long)totals.counts[c]);
+            for (int p=0; p<NUM_PHASES; p++)
+                length += std::snprintf(line + length, sizeof(line) - length, ", \"%s_seconds\": %.6f", PHASES[p],
+                                        totals.ticks[p] / ticksPerSecond);
+        }
+        std::snprintf(line + length, sizeof(line) - length, "}\n");
+
+        if (m_log) {
+            std::fputs(line, m_log);
+            std::fflush(m_log);
+        }
+        if (!m_statusPath.empty()) {
+            std::string tmpPath = m_statusPath + ".tmp";
+            FILE *f = std::fopen(tmpPath.c_str(), "w");
+            if (!f)
+                throw std::runtime_error("cannot write telemetry status " + tmpPath);
+            std::fputs(line, f);
+            bool ok = std::fclose(f) == 0;
+            if (!ok || std::rename(tmpPath.c_str(), m_statusPath.c_str()) != 0)
+                throw std::runtime_error("cannot write telemetry status " + m_statusPath);
+        }
+        m_last = now;
+        m_lastIterations = iterations;
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    FILE *m_log = nullptr;
+    std::string m_statusPath;
+    double m_interval = 0.0;
+    Clock::time_point m_start, m_last;
+    uint64_t m_startTicks = 0;
+    long m_lastIterations = 0;
+};
@@ -0,0 +1,266 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <iostream>
+#include <algorithm>
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#endif
+#include "PublicTree.h"
+#include "RegretPolicy.h"
+
+// Full-width CFR over the public betting tree. Instead of sampling one deal
+// per iteration, every iteration walks each public history once, carrying
+// the reach probabilities and counterfactual values of both players as
+// dense vectors over all of their private hands. Terminal values are
+// chance-weighted matrix-vector products, which run four hands per
+// instruction when built with AVX2 and FMA (e.g. -march=native).
+//
+// Game describes the public tree: NUM_HANDS, NUM_ACTIONS, HISTORY_IDS and
+// TERMINALS over betting-trie positions, SHOWDOWN results between hands and
+// the CHANCE probability of each (hand, opponent hand) deal, which must be
+// the same for both seats. Node tables are indexed historyId*NUM_HANDS + hand
+// and nodes need regretSum, strategySum, getStrategy() and
+// getAverageStrategy().
+template <typename Game>
+class VectorCFR {
+public:
+    static const int NUM_HANDS = Game::NUM_HANDS, NUM_ACTIONS = Game::NUM_ACTIONS;
+    // hand vectors are padded to a whole number of four-double registers
+    static const int STRIDE = (NUM_HANDS + 3) / 4 * 4;
+
+    struct alignas(32) HandVector {
+        std::array<double, STRIDE> v {};
+        double &operator[](int h) { return v[h]; }
+        double operator[](int h) const { return v[h]; }
+    };
+    // a matrix stored by columns, so that M x is a sum of scaled columns
+    typedef std::array<HandVector, NUM_HANDS> Matrix;
+
+    VectorCFR() {
+        for (int h=0; h<NUM_HANDS; h++) {
+            for (int j=0; j<NUM_HANDS; j++) {
+                m_chance[j][h] = Game::CHANCE[h][j];
+                m_showdown[j][h] = Game::CHANCE[h][j] * Game::SHOWDOWN[h][j];
+            }
+        }
+    }
+
+    // Iteration t (counting from 1) of CFR under the regret-update Policy
+    // (see RegretPolicy.h), with simultaneous updates unless the policy
+    // alternates. Returns the expected value of the current strategies for
+    // the first player.
+    template <typename Policy, typename NodeTable>
+    double iterate(NodeTable &nodes, long t) const {
+        Weights weights {Policy::regretWeight(t), Policy::strategyWeight(t)};
+        HandVector reach[2], values[2];
+        for (int h=0; h<NUM_HANDS; h++)
+            reach[0][h] = reach[1][h] = 1.0;
+        walk(nodes, 0, 0, reach, values, Policy::ALTERNATING ? 0 : BOTH_PLAYERS, weights);
+        double value = 0.0;
+        for (int h=0; h<NUM_HANDS; h++)
+            value += values[0][h];
+        if (Policy::ALTERNATING)
+            walk(nodes, 0, 0, reach, values, 1, weights);
+        if (Policy::TABLE_PASS)
+            for (auto &node : nodes)
+                Policy::endIteration(node, t);
+        return value;
+    }
+
+    // Exploitability of the average strategies in the node table: the mean
+    // of what each player wins by best responding to the other, in chips
+    // per game. It is zero exactly at a Nash equilibrium.
+    template <typename NodeTable>
+    double exploitability(const NodeTable &nodes) const {
+        double total = 0.0;
+        for (int player=0; player<2; player++) {
+            HandVector oppReach, values;
+            for (int h=0; h<NUM_HANDS; h++)
+                oppReach[h] = 1.0;
+            bestResponse(nodes, 0, 0, player, oppReach, values);
+            for (int h=0; h<NUM_HANDS; h++)
+                total += values[h];
+        }
+        return total / 2;
+    }
+
+private:
+    Matrix m_chance, m_showdown;
+
+    static const int BOTH_PLAYERS = -1;
+    struct Weights {
+        double regret, strategy;
+    };
+
+    // y = scale * M x
+    static void matVec(const Matrix &m, const HandVector &x, double scale, HandVector &y) {
+#if defined(__AVX2__) && defined(__FMA__)
+        for (int h=0; h<STRIDE; h+=4) {
+            __m256d sum = _mm256_setzero_pd();
+            for (int j=0; j<NUM_HANDS; j++)
+                sum = _mm256_fmadd_pd(_mm256_load_pd(&m[j].v[h]), _mm256_set1_pd(x[j]), sum);
+            _mm256_store_pd(&y.v[h], _mm256_mul_pd(sum, _mm256_set1_pd(scale)));
+        }
+#else
+        y = HandVector();
+        for (int j=0; j<NUM_HANDS; j++) {
+            double xj = scale * x[j];
+            for (int h=0; h<STRIDE; h++)
+                y[h] += m[j][h] * xj;
+        }
+#endif
+    }
+
+    // values[i][h] is player i's counterfactual value of holding hand h:
+    // its chance- and opponent-reach-weighted utility below this history
+    void terminalValues(const Terminal &terminal, int toAct, const HandVector reach[2], HandVector values[2]) const {
+        if (terminal.showdownStake) {
+            matVec(m_showdown, reach[1], terminal.showdownStake, values[0]);
+            matVec(m_showdown, reach[0], terminal.showdownStake, values[1]);
+        } else {
+            // the player to act after a fold is the one who did not fold
+            matVec(m_chance, reach[1-toAct], terminal.foldPayoff, values[toAct]);
+            matVec(m_chance, reach[toAct], -terminal.foldPayoff, values[1-toAct]);
+        }
+    }
+
+    // Only `updater`'s nodes are updated, or every node for BOTH_PLAYERS
+    template <typename NodeTable>
+    void walk(NodeTable &nodes, int pos, int depth, const HandVector reach[2], HandVector values[2], int updater,
+              const Weights &weights) const {
+        const Terminal &terminal = Game::TERMINALS[pos];
+        if (terminal.terminal) {
+            terminalValues(terminal, depth % 2, reach, values);
+            return;
+        }
+
+        int player = depth % 2, opponent = 1 - player;
+        bool update = updater == BOTH_PLAYERS || updater == player;
+        auto *row = &nodes[Game::HISTORY_IDS[pos]*NUM_HANDS];
+        std::array<std::array<double, NUM_ACTIONS>, NUM_HANDS> strategy;
+        for (int h=0; h<NUM_HANDS; h++) {
+            strategy[h] = row[h].getStrategy();
+            if (update)
+                for (int a=0; a<NUM_ACTIONS; a++)
+                    row[h].strategySum[a] += weights.strategy * reach[player][h] * strategy[h][a];
+        }
+
+        HandVector childReach[2], childValues[NUM_ACTIONS][2];
+        values[0] = values[1] = HandVector();
+        childReach[opponent] = reach[opponent];
+        for (int a=0; a<NUM_ACTIONS; a++) {
+            for (int h=0; h<NUM_HANDS; h++)
+                childReach[player][h] = reach[player][h] * strategy[h][a];
+            walk(nodes, NUM_ACTIONS*pos + 1 + a, depth + 1, childReach, childValues[a], updater, weights);
+            for (int h=0; h<NUM_HANDS; h++) {
+                values[player][h] += strategy[h][a] * childValues[a][player][h];
+                values[opponent][h] += childValues[a][opponent][h];
+            }
+        }
+
+        // counterfactual values already carry the opponent's reach
+        if (update)
+            for (int h=0; h<NUM_HANDS; h++)
+                for (int a=0; a<NUM_ACTIONS; a++)
+                    row[h].regretSum[a] += weights.regret * (childValues[a][player][h] - values[player][h]);
+    }
+
+    // values[h] is the responder's best-response counterfactual value of
+    // holding hand h against the opponent's average strategy
+    template <typename NodeTable>
+    void bestResponse(const NodeTable &nodes, int pos, int depth, int responder, const HandVector &oppReach,
+                      HandVector &values) const {
+        const Terminal &terminal = Game::TERMINALS[pos];
+        if (terminal.terminal) {
+            if (terminal.showdownStake)
+                matVec(m_showdown, oppReach, terminal.showdownStake, values);
+            else
+                matVec(m_chance, oppReach, depth % 2 == responder ? terminal.foldPayoff : -terminal.foldPayoff, values);
+            return;
+        }
+
+        auto *row = &nodes[Game::HISTORY_IDS[pos]*NUM_HANDS];
+        HandVector childReach, childValues;
+        if (depth % 2 == responder) {
+            for (int a=0; a<NUM_ACTIONS; a++) {
+                bestResponse(nodes, NUM_ACTIONS*pos + 1 + a, depth + 1, responder, oppReach, childValues);
+                for (int h=0; h<NUM_HANDS; h++)
+                    values[h] = a == 0 ? childValues[h] : std::max(values[h], childValues[h]);
+            }
+            return;
+        }
+
+        std::array<std::array<double, NUM_ACTIONS>, NUM_HANDS> strategy;
+        for (int h=0; h<NUM_HANDS; h++)
+            strategy[h] = row[h].getAverageStrategy();
+        values = HandVector();
+        for (int a=0; a<NUM_ACTIONS; a++) {
+            for (int h=0; h<NUM_HANDS; h++)
+                childReach[h] = oppReach[h] * strategy[h][a];
+            bestResponse(nodes, NUM_ACTIONS*pos + 1 + a, depth + 1, responder, childReach, childValues);
+            for (int h=0; h<NUM_HANDS; h++)
+                values[h] += childValues[h];
+        }
+    }
+};
+
+// Trains a fresh Trainer with chance sampling and then with vector CFR for
+// `seconds` of wall-clock time each, printing as CSV the exploitability of
+// the average strategy in mbb/g after batches of iterations that grow
+// geometrically. Trainer needs setVectorMode(), iterate(n) and
+// exploitability() in chips per game.
+template <typename Trainer>
+void reportConvergence(double seconds) {
+    using Clock = std::chrono::steady_clock;
+    std::cout << "method,iterations,seconds,exploitability_mbb\n";
+    for (bool vector : {false, true}) {
+        Trainer trainer;
+        if (vector)
+            trainer.setVectorMode();
+        long iterations = 0;
+        double elapsed = 0.0;
+        while (elapsed < seconds) {
+            long batch = std::max(1L, iterations / 4);
+            auto start = Clock::now();
+            trainer.iterate(batch);
+            elapsed += std::chrono::duration<double>(Clock::now() - start).count();
+            iterations += batch;
+            std::cout << (vector ? "vector" : "sampled") << "," << iterations << "," << elapsed << ","
+                      << 1000*trainer.exploitability() << "\n";
+        }
+    }
+}
+
+// For every regret-update policy, trains a fresh Trainer<Policy> with chance
+// sampling and then with vector CFR until the exploitability of its average
+// strategy is below `target` mbb/g, or for at most maxIterations iterations,
+// printing as CSV how many iterations and seconds that took. Exploitability
+// is checked after batches of 2% of the iterations so far. Trainer needs
+// the same as for reportConvergence().
+template <template <typename> class Trainer>
+void reportPolicyComparison(double target, long maxIterations) {
+    using Clock = std::chrono::steady_clock;
+    std::cout << "policy,method,iterations,seconds,exploitability_mbb,reached_target\n";
+    forEachPolicy([&](auto policy) {
+        for (bool vector : {false, true}) {
+            Trainer<decltype(policy)> trainer;
+            if (vector)
+                trainer.setVectorMode();
+            long iterations = 0;
+            double elapsed = 0.0, exploitability = 0.0;
+            while (iterations < maxIterations) {
+                long batch = std::min(maxIterations - iterations, std::max(1L, iterations / 50));
+                auto start = Clock::now();
+                trainer.iterate(batch);
+                elapsed += std::chrono::duration<double>(Clock::now() - start).count();
+                iterations += batch;
+                exploitability = 1000*trainer.exploitability();
+                if (exploitability < target)
+                    break;
+            }
+            std::cout << decltype(policy)::NAME << "," << (vector ? "vector" : "sampled") << "," << iterations << ","
+                      << elapsed << "," << exploitability << "," << (exploitability < target ? "yes" : "no") << "\n";
+        }
+    });
+}